@@ -0,0 +1,180 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/* Measures the cost of resizing many small images of the same
+ * size, either building a new carver for each of them or
+ * recycling a single carver with lqr_carver_reset; the setup
+ * time (construction and initialization, or reset) and the
+ * total time per image are reported. Each mode runs in its own
+ * process, so that it starts from a clean heap.
+ *
+ * usage: lqr-batch-bench [width height count ratio]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <lqr.h>
+#include "lqr_bench_util.h"
+
+#define BENCH_N_IMAGES 16
+
+/* result sent back by the child process */
+typedef struct {
+    int ok;
+    double setup;
+    double total;
+} BenchResult;
+
+/* resize count images, with a new carver for each of them or
+ * recycling the same one (the images are preserved, so that
+ * they can be used again) */
+static BenchResult
+bench_run(uint8_t **images, int w, int h, int count, int w1, int h1, int reuse)
+{
+    BenchResult res = { 0, 0, 0 };
+    LqrCarver *r = NULL;
+    double t0, t1;
+    int i;
+
+    t0 = bench_now();
+    for (i = 0; i < count; i++) {
+        t1 = bench_now();
+        if (reuse && (r != NULL)) {
+            if (lqr_carver_reset(r, images[i % BENCH_N_IMAGES], w, h) != LQR_OK) {
+                return res;
+            }
+        } else {
+            r = lqr_carver_new(images[i % BENCH_N_IMAGES], w, h, 3);
+            if ((r == NULL) || (lqr_carver_init(r, 1, 0) != LQR_OK)) {
+                return res;
+            }
+        }
+        lqr_carver_set_preserve_input_image(r);
+        res.setup += bench_now() - t1;
+        if (lqr_carver_resize(r, w1, h1) != LQR_OK) {
+            return res;
+        }
+        if (!reuse) {
+            lqr_carver_destroy(r);
+        }
+    }
+    if (reuse) {
+        lqr_carver_destroy(r);
+    }
+    res.total = bench_now() - t0;
+    res.ok = 1;
+    return res;
+}
+
+static BenchResult
+bench_fork(uint8_t **images, int w, int h, int count, int w1, int h1, int reuse)
+{
+    BenchResult res = { 0, 0, 0 };
+    int fd[2];
+    pid_t pid;
+    int status;
+
+    if (pipe(fd) != 0) {
+        return res;
+    }
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return res;
+    }
+    if (pid == 0) {
+        close(fd[0]);
+        res = bench_run(images, w, h, count, w1, h1, reuse);
+        if (write(fd[1], &res, sizeof(res)) != sizeof(res)) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(fd[1]);
+    if (read(fd[0], &res, sizeof(res)) != sizeof(res)) {
+        res.ok = 0;
+    }
+    close(fd[0]);
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+        res.ok = 0;
+    }
+    return res;
+}
+
+int
+main(int argc, char **argv)
+{
+    static const char *mode_names[2] = { "new", "reset" };
+    int w = 128;
+    int h = 96;
+    int count = 2000;
+    double ratio = 0.75;
+    int w1, h1;
+    uint8_t *images[BENCH_N_IMAGES];
+    BenchResult res;
+    int i;
+
+    if (argc == 5) {
+        w = atoi(argv[1]);
+        h = atoi(argv[2]);
+        count = atoi(argv[3]);
+        ratio = atof(argv[4]);
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [width height count ratio]\n", argv[0]);
+        return 1;
+    }
+    w1 = (int) (w * ratio + 0.5);
+    h1 = (int) (h * ratio + 0.5);
+    if ((w < 2) || (h < 2) || (count < 1) || (w1 < 1) || (h1 < 1)) {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    for (i = 0; i < BENCH_N_IMAGES; i++) {
+        if ((images[i] = bench_noise_new(w, h, 12345 + i)) == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+
+    printf("# %d images %dx%d -> %dx%d\n", count, w, h, w1, h1);
+    printf("# mode setup_us_per_image total_us_per_image\n");
+    for (i = 0; i < 2; i++) {
+        res = bench_fork(images, w, h, count, w1, h1, i);
+        if (!res.ok) {
+            fprintf(stderr, "%s: resize failed\n", mode_names[i]);
+            return 1;
+        }
+        printf("%s %.2f %.2f\n", mode_names[i], res.setup * 1e6 / count, res.total * 1e6 / count);
+    }
+
+    for (i = 0; i < BENCH_N_IMAGES; i++) {
+        free(images[i]);
+    }
+    return 0;
+}
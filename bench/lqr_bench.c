@@ -0,0 +1,524 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/* Benchmark over reproducible synthetic workloads: every combination
+ * of the given image sizes, channels, colour depths and patterns,
+ * energy functions, seam settings, resize orders and ratios is run
+ * in a child process, and the results (wall time, seams per second
+ * and peak resident memory of the child) are written as JSON to the
+ * standard output. If the library was built with LQR_ENABLE_STATS,
+ * the carver statistics of each run are included as well.
+ *
+ * usage: lqr-bench [options], run with --help for the list
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <lqr.h>
+#include "lqr_bench_util.h"
+
+#define BENCH_MAX_LIST 32
+
+typedef struct {
+    int n;
+    int v[BENCH_MAX_LIST];
+} BenchIntList;
+
+typedef struct {
+    int n;
+    double v[BENCH_MAX_LIST];
+} BenchDoubleList;
+
+/* a single run */
+typedef struct {
+    int width;
+    int height;
+    int channels;
+    LqrColDepth depth;
+    int pattern;
+    LqrEnergyFuncBuiltinType energy;
+    int delta_x;
+    double rigidity;
+    LqrResizeOrder order;
+    double ratio;
+} BenchCase;
+
+/* result sent back by the child process */
+typedef struct {
+    int ok;
+    int new_width;
+    int new_height;
+    double wall;
+    size_t mem_peak;
+    int has_stats;
+    LqrCarverStats stats;
+} BenchResult;
+
+enum {
+    BENCH_NOISE,
+    BENCH_GRADIENT,
+    BENCH_EDGES,
+    BENCH_TEXTURE,
+    BENCH_N_PATTERNS
+};
+
+static const char *pattern_names[] = { "noise", "gradient", "edges", "texture" };
+static const char *depth_names[] = { "8i", "16i", "32f", "64f" };
+static const char *energy_names[] = { "grad_norm", "grad_sumabs", "grad_xabs", "luma_grad_norm",
+                                      "luma_grad_sumabs", "luma_grad_xabs", "null" };
+static const char *order_names[] = { "hor", "vert" };
+static const char *phase_names[] = { "build_emap", "update_emap", "build_mmap", "update_mmap", "build_vpath",
+                                     "carve", "inflate", "flatten", "transpose", "readout" };
+
+/* settings shared by all runs */
+static int n_threads = 1;
+static int compact = 0;
+static int seams_per_pass = 1;
+static int pyramid = 1;
+static int repeat = 1;
+static unsigned int seed = 1;
+
+static void
+usage(const char *name)
+{
+    printf("usage: %s [options]\n"
+           "  lists are comma separated:\n"
+           "  --sizes WxH,...         image sizes (default 256x192)\n"
+           "  --channels N,...        number of channels (default 3)\n"
+           "  --depths D,...          colour depths: 8i 16i 32f 64f (default 8i)\n"
+           "  --patterns P,...        noise gradient edges texture (default all)\n"
+           "  --energies E,...        grad_norm grad_sumabs grad_xabs luma_grad_norm\n"
+           "                          luma_grad_sumabs luma_grad_xabs null (default all)\n"
+           "  --delta-x N,...         max seam step (default 1)\n"
+           "  --rigidity R,...        seam rigidity (default 0)\n"
+           "  --orders O,...          resize order: hor vert (default hor)\n"
+           "  --ratios R,...          size ratio for both dimensions (default 0.75,1.25)\n"
+           "  --threads N             threads per carver (default 1)\n"
+           "  --compact               use the compact maps layout\n"
+           "  --seams-per-pass N      seams per minpath map (default 1)\n"
+           "  --pyramid F             multi-resolution search factor (default 1)\n"
+           "  --repeat N              runs per case, the fastest is reported (default 1)\n"
+           "  --seed N                seed of the synthetic images (default 1)\n", name);
+}
+
+/* parse a list of names ("all" selects all of them) */
+static int
+parse_names(const char *arg, const char **names, int n_names, BenchIntList *list)
+{
+    char *buf, *tok, *save = NULL;
+    int i;
+
+    list->n = 0;
+    if (strcmp(arg, "all") == 0) {
+        for (i = 0; i < n_names; i++) {
+            list->v[list->n++] = i;
+        }
+        return 0;
+    }
+    buf = strdup(arg);
+    for (tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        for (i = 0; i < n_names; i++) {
+            if (strcmp(tok, names[i]) == 0) {
+                break;
+            }
+        }
+        if ((i == n_names) || (list->n == BENCH_MAX_LIST)) {
+            fprintf(stderr, "invalid value: %s\n", tok);
+            free(buf);
+            return 1;
+        }
+        list->v[list->n++] = i;
+    }
+    free(buf);
+    return list->n == 0;
+}
+
+static int
+parse_ints(const char *arg, BenchIntList *list, int min)
+{
+    char *buf, *tok, *save = NULL;
+
+    list->n = 0;
+    buf = strdup(arg);
+    for (tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        if ((list->n == BENCH_MAX_LIST) || (atoi(tok) < min)) {
+            fprintf(stderr, "invalid value: %s\n", tok);
+            free(buf);
+            return 1;
+        }
+        list->v[list->n++] = atoi(tok);
+    }
+    free(buf);
+    return list->n == 0;
+}
+
+static int
+parse_doubles(const char *arg, BenchDoubleList *list, double min)
+{
+    char *buf, *tok, *save = NULL;
+
+    list->n = 0;
+    buf = strdup(arg);
+    for (tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        if ((list->n == BENCH_MAX_LIST) || (atof(tok) < min)) {
+            fprintf(stderr, "invalid value: %s\n", tok);
+            free(buf);
+            return 1;
+        }
+        list->v[list->n++] = atof(tok);
+    }
+    free(buf);
+    return list->n == 0;
+}
+
+/* sizes are given as pairs in a single list */
+static int
+parse_sizes(const char *arg, BenchIntList *list)
+{
+    char *buf, *tok, *save = NULL;
+    int w, h;
+
+    list->n = 0;
+    buf = strdup(arg);
+    for (tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        if ((list->n == BENCH_MAX_LIST) || (sscanf(tok, "%dx%d", &w, &h) != 2) || (w < 2) || (h < 2)) {
+            fprintf(stderr, "invalid size: %s\n", tok);
+            free(buf);
+            return 1;
+        }
+        list->v[list->n++] = w;
+        list->v[list->n++] = h;
+    }
+    free(buf);
+    return list->n == 0;
+}
+
+static double
+bench_rand(unsigned int *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return (*state % 100000) / 99999.0;
+}
+
+/* pixel value in [0, 1] */
+static double
+bench_pattern(int pattern, int x, int y, int k, int w, int h, unsigned int *state, const double *levels)
+{
+    double v;
+
+    switch (pattern) {
+        case BENCH_NOISE:
+            return bench_rand(state);
+        case BENCH_GRADIENT:
+            return (x / (double) w + y / (double) h + k * 0.1) / (2 + k * 0.1);
+        case BENCH_EDGES:
+            /* piecewise constant blocks */
+            return levels[((y * 8 / h) * 8 + (x * 8 / w) + k * 5) % 64];
+        case BENCH_TEXTURE:
+        default:
+            v = 0.5 + 0.25 * sin(x * 0.31 + k) * cos(y * 0.17) + 0.15 * sin((x + y) * 0.05);
+            v += 0.1 * (bench_rand(state) - 0.5);
+            return v < 0 ? 0 : (v > 1 ? 1 : v);
+    }
+}
+
+static void *
+bench_image_new(const BenchCase *c)
+{
+    size_t n = (size_t) c->width * c->height * c->channels;
+    size_t size[] = { 1, 2, 4, 8 };
+    unsigned char *buffer;
+    unsigned int state = seed * 2654435761u + c->pattern + 1;
+    double levels[64];
+    double v;
+    size_t i;
+    int x, y, k;
+
+    for (i = 0; i < 64; i++) {
+        levels[i] = bench_rand(&state);
+    }
+    buffer = malloc(n * size[c->depth]);
+    if (buffer == NULL) {
+        return NULL;
+    }
+    i = 0;
+    for (y = 0; y < c->height; y++) {
+        for (x = 0; x < c->width; x++) {
+            for (k = 0; k < c->channels; k++, i++) {
+                v = bench_pattern(c->pattern, x, y, k, c->width, c->height, &state, levels);
+                switch (c->depth) {
+                    case LQR_COLDEPTH_8I:
+                        ((lqr_t_8i *) buffer)[i] = (lqr_t_8i) (v * 255 + 0.5);
+                        break;
+                    case LQR_COLDEPTH_16I:
+                        ((lqr_t_16i *) buffer)[i] = (lqr_t_16i) (v * 65535 + 0.5);
+                        break;
+                    case LQR_COLDEPTH_32F:
+                        ((lqr_t_32f *) buffer)[i] = (lqr_t_32f) v;
+                        break;
+                    case LQR_COLDEPTH_64F:
+                        ((lqr_t_64f *) buffer)[i] = v;
+                        break;
+                }
+            }
+        }
+    }
+    return buffer;
+}
+
+/* runs in the child process */
+static BenchResult
+bench_run(const BenchCase *c)
+{
+    BenchResult res;
+    LqrCarver *r;
+    void *buffer;
+    double t0;
+
+    memset(&res, 0, sizeof(res));
+    buffer = bench_image_new(c);
+    if (buffer == NULL) {
+        return res;
+    }
+    r = lqr_carver_new_ext(buffer, c->width, c->height, c->channels, c->depth);
+    if ((r == NULL) || (lqr_carver_init(r, c->delta_x, (float) c->rigidity) != LQR_OK)
+        || (lqr_carver_set_energy_function_builtin(r, c->energy) != LQR_OK)
+        || (lqr_carver_set_n_threads(r, n_threads) != LQR_OK)
+        || (lqr_carver_set_compact_layout(r, compact) != LQR_OK)
+        || (lqr_carver_set_seams_per_pass(r, seams_per_pass) != LQR_OK)
+        || (lqr_carver_set_pyramid(r, pyramid, 0) != LQR_OK)) {
+        return res;
+    }
+    lqr_carver_set_resize_order(r, c->order);
+
+    res.new_width = MAX((int) (c->width * c->ratio + 0.5), 1);
+    res.new_height = MAX((int) (c->height * c->ratio + 0.5), 1);
+
+    t0 = bench_now();
+    res.ok = lqr_carver_resize(r, res.new_width, res.new_height) == LQR_OK;
+    res.wall = bench_now() - t0;
+    res.mem_peak = lqr_carver_get_memory_peak(r);
+    res.has_stats = lqr_carver_get_stats(r, &res.stats) == LQR_OK;
+
+    lqr_carver_destroy(r);
+    return res;
+}
+
+/* run a case in a child process, so that its peak memory can be measured */
+static int
+bench_fork(const BenchCase *c, BenchResult *res, long *peak_kb)
+{
+    int fd[2];
+    pid_t pid;
+    int status;
+    struct rusage usage;
+
+    if (pipe(fd) != 0) {
+        return 1;
+    }
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return 1;
+    }
+    if (pid == 0) {
+        close(fd[0]);
+        *res = bench_run(c);
+        if (write(fd[1], res, sizeof(*res)) != sizeof(*res)) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(fd[1]);
+    if (read(fd[0], res, sizeof(*res)) != sizeof(*res)) {
+        res->ok = 0;
+    }
+    close(fd[0]);
+    *peak_kb = 0;
+    if (wait4(pid, &status, 0, &usage) != pid) {
+        res->ok = 0;
+        return 0;
+    }
+    if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+        res->ok = 0;
+    }
+    *peak_kb = usage.ru_maxrss;
+    return 0;
+}
+
+static void
+bench_print(const BenchCase *c, const BenchResult *res, long peak_kb, int first)
+{
+    int seams = abs(res->new_width - c->width) + abs(res->new_height - c->height);
+    int i;
+
+    printf("%s    {\"pattern\": \"%s\", \"width\": %d, \"height\": %d, \"channels\": %d, \"depth\": \"%s\", "
+           "\"energy\": \"%s\", \"delta_x\": %d, \"rigidity\": %g, \"order\": \"%s\", \"ratio\": %g, "
+           "\"new_width\": %d, \"new_height\": %d, \"seams\": %d, \"ok\": %s, \"wall_s\": %.6f, "
+           "\"seams_per_s\": %.1f, \"peak_rss_kb\": %ld, \"peak_lqr_bytes\": %zu",
+           first ? "" : ",\n", pattern_names[c->pattern], c->width, c->height, c->channels, depth_names[c->depth],
+           energy_names[c->energy], c->delta_x, c->rigidity, order_names[c->order], c->ratio, res->new_width,
+           res->new_height, seams, res->ok ? "true" : "false", res->wall, res->wall > 0 ? seams / res->wall : 0,
+           peak_kb, res->mem_peak);
+
+    /* only available if the library collects statistics */
+    if (res->has_stats) {
+        printf(", \"stats\": {");
+        for (i = 0; i < LQR_STATS_N_PHASES; i++) {
+            printf("\"%s\": {\"ns\": %llu, \"calls\": %llu}, ", phase_names[i],
+                   (unsigned long long) res->stats.ns[i], (unsigned long long) res->stats.calls[i]);
+        }
+        printf("\"energy_evals\": %llu, \"mmap_cells\": %llu, \"bytes_allocated\": %llu}",
+               (unsigned long long) res->stats.energy_evals, (unsigned long long) res->stats.mmap_cells,
+               (unsigned long long) res->stats.bytes_allocated);
+    }
+    printf("}");
+}
+
+int
+main(int argc, char **argv)
+{
+    BenchIntList sizes = { 2, { 256, 192 } };
+    BenchIntList channels = { 1, { 3 } };
+    BenchIntList depths = { 1, { LQR_COLDEPTH_8I } };
+    BenchIntList patterns;
+    BenchIntList energies;
+    BenchIntList delta_x = { 1, { 1 } };
+    BenchDoubleList rigidity = { 1, { 0 } };
+    BenchIntList orders = { 1, { LQR_RES_ORDER_HOR } };
+    BenchDoubleList ratios = { 2, { 0.75, 1.25 } };
+    BenchCase c;
+    BenchResult res, best;
+    long peak_kb, best_peak_kb;
+    int is, ic, id, ip, ie, ix, ir, io, ia, n;
+    int first = 1;
+    int err = 0;
+    int i;
+
+    parse_names("all", pattern_names, BENCH_N_PATTERNS, &patterns);
+    parse_names("all", energy_names, LQR_EF_NULL + 1, &energies);
+
+    for (i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        const char *arg = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(opt, "--help") == 0) {
+            usage(argv[0]);
+            return 0;
+        } else if (strcmp(opt, "--compact") == 0) {
+            compact = 1;
+            continue;
+        } else if (arg == NULL) {
+            err = 1;
+        } else if (strcmp(opt, "--sizes") == 0) {
+            err = parse_sizes(arg, &sizes);
+        } else if (strcmp(opt, "--channels") == 0) {
+            err = parse_ints(arg, &channels, 1);
+        } else if (strcmp(opt, "--depths") == 0) {
+            err = parse_names(arg, depth_names, 4, &depths);
+        } else if (strcmp(opt, "--patterns") == 0) {
+            err = parse_names(arg, pattern_names, BENCH_N_PATTERNS, &patterns);
+        } else if (strcmp(opt, "--energies") == 0) {
+            err = parse_names(arg, energy_names, LQR_EF_NULL + 1, &energies);
+        } else if (strcmp(opt, "--delta-x") == 0) {
+            err = parse_ints(arg, &delta_x, 0);
+        } else if (strcmp(opt, "--rigidity") == 0) {
+            err = parse_doubles(arg, &rigidity, 0);
+        } else if (strcmp(opt, "--orders") == 0) {
+            err = parse_names(arg, order_names, 2, &orders);
+        } else if (strcmp(opt, "--ratios") == 0) {
+            err = parse_doubles(arg, &ratios, 0.01);
+        } else if (strcmp(opt, "--threads") == 0) {
+            err = (n_threads = atoi(arg)) < 1;
+        } else if (strcmp(opt, "--seams-per-pass") == 0) {
+            err = (seams_per_pass = atoi(arg)) < 1;
+        } else if (strcmp(opt, "--pyramid") == 0) {
+            err = (pyramid = atoi(arg)) < 1;
+        } else if (strcmp(opt, "--repeat") == 0) {
+            err = (repeat = atoi(arg)) < 1;
+        } else if (strcmp(opt, "--seed") == 0) {
+            seed = (unsigned int) strtoul(arg, NULL, 10);
+        } else {
+            err = 1;
+        }
+        if (err) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    printf("{\n  \"benchmark\": \"lqr-bench\",\n  \"cpu_level\": %d,\n  \"threads\": %d,\n  \"compact\": %s,\n"
+           "  \"seams_per_pass\": %d,\n  \"pyramid\": %d,\n  \"repeat\": %d,\n  \"seed\": %u,\n  \"results\": [\n",
+           lqr_cpu_get_level(), n_threads, compact ? "true" : "false", seams_per_pass, pyramid, repeat, seed);
+
+    for (is = 0; is < sizes.n; is += 2)
+    for (ic = 0; ic < channels.n; ic++)
+    for (id = 0; id < depths.n; id++)
+    for (ip = 0; ip < patterns.n; ip++)
+    for (ie = 0; ie < energies.n; ie++)
+    for (ix = 0; ix < delta_x.n; ix++)
+    for (ir = 0; ir < rigidity.n; ir++)
+    for (io = 0; io < orders.n; io++)
+    for (ia = 0; ia < ratios.n; ia++) {
+        c.width = sizes.v[is];
+        c.height = sizes.v[is + 1];
+        c.channels = channels.v[ic];
+        c.depth = (LqrColDepth) depths.v[id];
+        c.pattern = patterns.v[ip];
+        c.energy = (LqrEnergyFuncBuiltinType) energies.v[ie];
+        c.delta_x = delta_x.v[ix];
+        c.rigidity = rigidity.v[ir];
+        c.order = (LqrResizeOrder) orders.v[io];
+        c.ratio = ratios.v[ia];
+
+        best.ok = 0;
+        best_peak_kb = 0;
+        for (n = 0; n < repeat; n++) {
+            if (bench_fork(&c, &res, &peak_kb)) {
+                res.ok = 0;
+            }
+            if ((n == 0) || (res.ok && (!best.ok || (res.wall < best.wall)))) {
+                best = res;
+            }
+            best_peak_kb = MAX(best_peak_kb, peak_kb);
+        }
+        bench_print(&c, &best, best_peak_kb, first);
+        first = 0;
+    }
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
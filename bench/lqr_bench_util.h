@@ -0,0 +1,64 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+
+/* Helpers shared by the benchmark programs */
+
+#ifndef __LQR_BENCH_UTIL_H__
+#define __LQR_BENCH_UTIL_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* monotonic time, in seconds */
+static inline double
+bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* 8 bit RGB image of xorshift noise, the same for the same seed
+ * (which must not be 0) */
+static inline uint8_t *
+bench_noise_new(int w, int h, uint32_t seed)
+{
+    uint8_t *buffer;
+    size_t i;
+
+    buffer = malloc((size_t) w * h * 3);
+    if (buffer == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < (size_t) w * h * 3; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        buffer[i] = (uint8_t) (seed % 256);
+    }
+    return buffer;
+}
+
+#endif /* __LQR_BENCH_UTIL_H__ */
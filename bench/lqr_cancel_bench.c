@@ -0,0 +1,225 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/* Measures the cancellation latency: a resize is started in a
+ * separate thread and cancelled (lqr_carver_cancel) after a random
+ * delay; the time taken by the cancel call itself and the time
+ * from the cancellation to the return of lqr_carver_resize are
+ * reported. Optionally, some busy threads keep the cpus loaded.
+ * The program fails (exit status 1) if a cancelled resize takes more
+ * than max_ms milliseconds to return, so it can be used as a check.
+ *
+ * usage: lqr-cancel-bench [width height trials threads load [max_ms]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <lqr.h>
+#include "lqr_bench_util.h"
+
+typedef struct {
+    LqrCarver *r;
+    int w1;
+    int h1;
+    LqrRetVal ret;
+    double t_end;
+} BenchJob;
+
+static atomic_int bench_quit;
+
+static void
+bench_sleep(double t)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t) t;
+    ts.tv_nsec = (long) ((t - ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+static LqrCarver *
+bench_carver_new(int w, int h, int n_threads)
+{
+    LqrCarver *r;
+    uint8_t *buffer;
+
+    buffer = bench_noise_new(w, h, 12345);
+    if (buffer == NULL) {
+        return NULL;
+    }
+    r = lqr_carver_new(buffer, w, h, 3);
+    if ((r == NULL) || (lqr_carver_init(r, 1, 0) != LQR_OK) || (lqr_carver_set_n_threads(r, n_threads) != LQR_OK)) {
+        lqr_carver_destroy(r);
+        return NULL;
+    }
+    return r;
+}
+
+static void *
+bench_resize(void *data)
+{
+    BenchJob *job = (BenchJob *) data;
+
+    job->ret = lqr_carver_resize(job->r, job->w1, job->h1);
+    job->t_end = bench_now();
+    return NULL;
+}
+
+static void *
+bench_load(void *data)
+{
+    volatile double x = 1;
+
+    (void) data;
+    while (!atomic_load(&bench_quit)) {
+        x = x * 1.000001 + 1e-9;
+    }
+    return NULL;
+}
+
+static int
+bench_cmp(const void *a, const void *b)
+{
+    double d = *(const double *) a - *(const double *) b;
+
+    return (d > 0) - (d < 0);
+}
+
+int
+main(int argc, char **argv)
+{
+    int w = 1024;
+    int h = 768;
+    int trials = 50;
+    int n_threads = 1;
+    int n_load = 0;
+    double max_latency = 0.1;
+    pthread_t *load = NULL;
+    pthread_t thread;
+    BenchJob job;
+    double t_full, t0, t_cancel, t_after;
+    double *latency, *cancel_time;
+    uint32_t seed = 777;
+    int i, n = 0;
+    int ok;
+
+    if ((argc == 6) || (argc == 7)) {
+        w = atoi(argv[1]);
+        h = atoi(argv[2]);
+        trials = atoi(argv[3]);
+        n_threads = atoi(argv[4]);
+        n_load = atoi(argv[5]);
+        if (argc == 7) {
+            max_latency = atof(argv[6]) * 1e-3;
+        }
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [width height trials threads load [max_ms]]\n", argv[0]);
+        return 1;
+    }
+    if ((w < 4) || (h < 4) || (trials < 1) || (n_threads < 1) || (n_load < 0) || (max_latency <= 0)) {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    latency = calloc(trials, sizeof(double));
+    cancel_time = calloc(trials, sizeof(double));
+    if (n_load > 0) {
+        load = calloc(n_load, sizeof(pthread_t));
+    }
+    if ((latency == NULL) || (cancel_time == NULL) || ((n_load > 0) && (load == NULL))) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < n_load; i++) {
+        pthread_create(&load[i], NULL, bench_load, NULL);
+    }
+
+    /* reference: uncancelled resize */
+    job.w1 = w * 3 / 4;
+    job.h1 = h * 5 / 4;
+    if ((job.r = bench_carver_new(w, h, n_threads)) == NULL) {
+        fprintf(stderr, "could not create the carver\n");
+        return 1;
+    }
+    t0 = bench_now();
+    bench_resize(&job);
+    t_full = job.t_end - t0;
+    lqr_carver_destroy(job.r);
+    if (job.ret != LQR_OK) {
+        fprintf(stderr, "resize failed\n");
+        return 1;
+    }
+
+    for (i = 0; i < trials; i++) {
+        if ((job.r = bench_carver_new(w, h, n_threads)) == NULL) {
+            fprintf(stderr, "could not create the carver\n");
+            return 1;
+        }
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+
+        pthread_create(&thread, NULL, bench_resize, &job);
+        bench_sleep(t_full * (seed % 1000) / 1000.0);
+        t_cancel = bench_now();
+        lqr_carver_cancel(job.r);
+        t_after = bench_now();
+        pthread_join(thread, NULL);
+
+        /* only count the resizes which were actually interrupted */
+        if (job.ret == LQR_USRCANCEL) {
+            latency[n] = job.t_end - t_cancel;
+            cancel_time[n] = t_after - t_cancel;
+            n++;
+        }
+        lqr_carver_destroy(job.r);
+    }
+
+    atomic_store(&bench_quit, 1);
+    for (i = 0; i < n_load; i++) {
+        pthread_join(load[i], NULL);
+    }
+
+    printf("# %dx%d -> %dx%d, %d threads, %d load threads, full resize %.3f s\n", w, h, job.w1, job.h1,
+           n_threads, n_load, t_full);
+    printf("# cancelled/trials latency_us(median p90 max) cancel_call_us(median max)\n");
+    if (n > 0) {
+        qsort(latency, n, sizeof(double), bench_cmp);
+        qsort(cancel_time, n, sizeof(double), bench_cmp);
+        printf("%d/%d %.1f %.1f %.1f %.1f %.1f\n", n, trials, latency[n / 2] * 1e6, latency[n * 9 / 10] * 1e6,
+               latency[n - 1] * 1e6, cancel_time[n / 2] * 1e6, cancel_time[n - 1] * 1e6);
+    } else {
+        printf("0/%d\n", trials);
+    }
+
+    ok = (n == 0) || (latency[n - 1] <= max_latency);
+    printf("# max latency %s %.1f ms\n", ok ? "within" : "EXCEEDS", max_latency * 1e3);
+
+    free(latency);
+    free(cancel_time);
+    free(load);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/* Resizes an image to several aspect ratios, all of them with the
+ * same width and different heights, and reports the total time and
+ * the memory held by the library once all the carvers are set up and
+ * once all the results are ready:
+ * with a new carver per target, each one computing the width maps,
+ * and with a single carver whose width maps are computed once (down
+ * to the smallest width) and then cloned (lqr_carver_clone) for
+ * each target. The results of the two are compared.
+ *
+ * usage: lqr-clone-bench [width height targets ratio]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <lqr.h>
+#include "lqr_bench_util.h"
+
+/* resize each carver to its target and export the result */
+static int
+bench_resize_all(LqrCarver **carvers, int n_targets, int w1, const int *heights, uint8_t **out)
+{
+    int i;
+
+    for (i = 0; i < n_targets; i++) {
+        if ((lqr_carver_resize(carvers[i], w1, heights[i]) != LQR_OK)
+            || (lqr_carver_export(carvers[i], out[i], (size_t) w1 * 3, LQR_COLDEPTH_8I, NULL) != LQR_OK)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+    int w = 1024;
+    int h = 768;
+    int n_targets = 8;
+    double ratio = 0.6;
+    uint8_t *image;
+    uint8_t **ref, **out;
+    int *heights;
+    LqrCarver **carvers;
+    LqrCarver *r;
+    size_t mem_setup, mem;
+    double t0, t;
+    int i, w1, same;
+
+    if (argc == 5) {
+        w = atoi(argv[1]);
+        h = atoi(argv[2]);
+        n_targets = atoi(argv[3]);
+        ratio = atof(argv[4]);
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [width height targets ratio]\n", argv[0]);
+        return 1;
+    }
+    if ((w < 4) || (h < 4) || (n_targets < 1) || (ratio <= 0) || (ratio >= 1)) {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    /* the width is reduced by ratio, the heights are
+     * spread evenly between h and ratio * h */
+    w1 = (int) (w * ratio);
+    heights = malloc(n_targets * sizeof(int));
+    carvers = calloc(n_targets, sizeof(LqrCarver *));
+    ref = calloc(n_targets, sizeof(uint8_t *));
+    out = calloc(n_targets, sizeof(uint8_t *));
+    if ((heights == NULL) || (carvers == NULL) || (ref == NULL) || (out == NULL)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < n_targets; i++) {
+        heights[i] = h - (int) ((h - h * ratio) * i / (n_targets > 1 ? n_targets - 1 : 1));
+        ref[i] = malloc((size_t) w1 * heights[i] * 3);
+        out[i] = malloc((size_t) w1 * heights[i] * 3);
+        if ((ref[i] == NULL) || (out[i] == NULL)) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+
+    printf("# %dx%d, %d targets %dx%d to %dx%d\n", w, h, n_targets, w1, heights[0], w1, heights[n_targets - 1]);
+    printf("# mode ms_total ms_per_target lqr_bytes_setup lqr_bytes_held\n");
+
+    /* a new carver per target */
+    t0 = bench_now();
+    for (i = 0; i < n_targets; i++) {
+        if (((image = bench_noise_new(w, h, 12345)) == NULL)
+            || ((carvers[i] = lqr_carver_new(image, w, h, 3)) == NULL) || (lqr_carver_init(carvers[i], 1, 0) != LQR_OK)) {
+            fprintf(stderr, "new: setup failed\n");
+            return 1;
+        }
+    }
+    mem_setup = lqr_get_memory_usage();
+    if (!bench_resize_all(carvers, n_targets, w1, heights, ref)) {
+        fprintf(stderr, "new: resize failed\n");
+        return 1;
+    }
+    t = bench_now() - t0;
+    mem = lqr_get_memory_usage();
+    printf("new %.2f %.2f %zu %zu\n", t * 1e3, t * 1e3 / n_targets, mem_setup, mem);
+    for (i = 0; i < n_targets; i++) {
+        lqr_carver_destroy(carvers[i]);
+    }
+
+    /* one precomputation, then a clone per target */
+    t0 = bench_now();
+    if (((image = bench_noise_new(w, h, 12345)) == NULL)
+        || ((r = lqr_carver_new(image, w, h, 3)) == NULL) || (lqr_carver_init(r, 1, 0) != LQR_OK)
+        || (lqr_carver_resize(r, w1, h) != LQR_OK)) {
+        fprintf(stderr, "clone: setup failed\n");
+        return 1;
+    }
+    for (i = 0; i < n_targets; i++) {
+        if ((carvers[i] = lqr_carver_clone(r)) == NULL) {
+            fprintf(stderr, "clone: clone failed\n");
+            return 1;
+        }
+    }
+    mem_setup = lqr_get_memory_usage();
+    if (!bench_resize_all(carvers, n_targets, w1, heights, out)) {
+        fprintf(stderr, "clone: resize failed\n");
+        return 1;
+    }
+    t = bench_now() - t0;
+    mem = lqr_get_memory_usage();
+    printf("clone %.2f %.2f %zu %zu\n", t * 1e3, t * 1e3 / n_targets, mem_setup, mem);
+    for (i = 0; i < n_targets; i++) {
+        lqr_carver_destroy(carvers[i]);
+    }
+    lqr_carver_destroy(r);
+
+    same = 1;
+    for (i = 0; i < n_targets; i++) {
+        same = same && (memcmp(ref[i], out[i], (size_t) w1 * heights[i] * 3) == 0);
+        free(ref[i]);
+        free(out[i]);
+    }
+    printf("# results %s\n", same ? "identical" : "DIFFERENT");
+
+    free(heights);
+    free(carvers);
+    free(ref);
+    free(out);
+
+    return same ? 0 : 1;
+}
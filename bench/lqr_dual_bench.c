@@ -0,0 +1,221 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/* Replays an interactive session in which the width and the height
+ * of an image are dragged in turns, one resize per step, and reports
+ * the mean and maximum time of a step, the mean time of the steps
+ * after the first one of each drag, and the peak memory of the
+ * carver, for three ways of serving it: a single carver resized in
+ * place (each resize starts from the previous result), a new carver
+ * for each step (each resize starts from the original image) and a
+ * single carver with the dual orientation cache (each resize starts
+ * from the original image). As an interactive tool would do, the
+ * resize order is set so that the dragged axis is the second one,
+ * which lets the cache serve a drag from a single set of maps.
+ * Each mode runs in its own process.
+ *
+ * usage: lqr-dual-bench [width height steps ratio]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <lqr.h>
+#include "lqr_bench_util.h"
+
+#define BENCH_N_PHASES 6
+#define BENCH_N_MODES 3
+
+/* result sent back by the child process */
+typedef struct {
+    int ok;
+    int n_steps;
+    double total;
+    double inner;
+    double max;
+    size_t peak;
+} BenchResult;
+
+static LqrCarver *
+bench_carver_new(uint8_t *image, int w, int h)
+{
+    LqrCarver *r;
+
+    r = lqr_carver_new(image, w, h, 3);
+    if ((r == NULL) || (lqr_carver_init(r, 1, 0) != LQR_OK)) {
+        return NULL;
+    }
+    lqr_carver_set_preserve_input_image(r);
+    return r;
+}
+
+/* mode 0: in place, 1: new carver per step, 2: dual cache */
+static BenchResult
+bench_run(uint8_t *image, int w, int h, int steps, double ratio, int mode)
+{
+    /* targets of the drags, as fractions of the way to the
+     * smallest size; even phases drag the width, odd ones the height */
+    static const double phases[BENCH_N_PHASES] = { 1, 1, 0.5, 0.5, 1, 1 };
+    BenchResult res = { 0, 0, 0, 0, 0, 0 };
+    LqrCarver *r = NULL;
+    int w1 = w;
+    int h1 = h;
+    int p, i, from, to;
+    size_t peak;
+    double t0, t;
+
+    if (mode != 1) {
+        if ((r = bench_carver_new(image, w, h)) == NULL) {
+            return res;
+        }
+        if ((mode == 2) && (lqr_carver_set_dual_cache(r, true) != LQR_OK)) {
+            return res;
+        }
+    }
+
+    for (p = 0; p < BENCH_N_PHASES; p++) {
+        from = (p % 2) ? h1 : w1;
+        to = (int) (((p % 2) ? h : w) * (1 - (1 - ratio) * phases[p]) + 0.5);
+        for (i = 1; i <= steps; i++) {
+            if (p % 2) {
+                h1 = from + (to - from) * i / steps;
+            } else {
+                w1 = from + (to - from) * i / steps;
+            }
+            t0 = bench_now();
+            if (mode == 1) {
+                if ((r = bench_carver_new(image, w, h)) == NULL) {
+                    return res;
+                }
+            }
+            lqr_carver_set_resize_order(r, (p % 2) ? LQR_RES_ORDER_HOR : LQR_RES_ORDER_VERT);
+            if (lqr_carver_resize(r, w1, h1) != LQR_OK) {
+                return res;
+            }
+            t = bench_now() - t0;
+            peak = lqr_carver_get_memory_peak(r);
+            if (mode == 1) {
+                lqr_carver_destroy(r);
+            }
+            res.total += t;
+            if (i > 1) {
+                res.inner += t;
+            }
+            res.max = t > res.max ? t : res.max;
+            res.peak = peak > res.peak ? peak : res.peak;
+            res.n_steps++;
+        }
+    }
+
+    if (mode != 1) {
+        lqr_carver_destroy(r);
+    }
+    res.ok = 1;
+    return res;
+}
+
+static BenchResult
+bench_fork(uint8_t *image, int w, int h, int steps, double ratio, int mode)
+{
+    BenchResult res = { 0, 0, 0, 0, 0, 0 };
+    int fd[2];
+    pid_t pid;
+    int status;
+
+    if (pipe(fd) != 0) {
+        return res;
+    }
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return res;
+    }
+    if (pid == 0) {
+        close(fd[0]);
+        res = bench_run(image, w, h, steps, ratio, mode);
+        if (write(fd[1], &res, sizeof(res)) != sizeof(res)) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    close(fd[1]);
+    if (read(fd[0], &res, sizeof(res)) != sizeof(res)) {
+        res.ok = 0;
+    }
+    close(fd[0]);
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+        res.ok = 0;
+    }
+    return res;
+}
+
+int
+main(int argc, char **argv)
+{
+    static const char *mode_names[BENCH_N_MODES] = { "in-place", "new", "dual" };
+    int w = 400;
+    int h = 300;
+    int steps = 8;
+    double ratio = 0.7;
+    uint8_t *image;
+    BenchResult res;
+    int i;
+
+    if (argc == 5) {
+        w = atoi(argv[1]);
+        h = atoi(argv[2]);
+        steps = atoi(argv[3]);
+        ratio = atof(argv[4]);
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [width height steps ratio]\n", argv[0]);
+        return 1;
+    }
+    if ((w < 4) || (h < 4) || (steps < 2) || (ratio <= 0) || (ratio >= 1)) {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    if ((image = bench_noise_new(w, h, 12345)) == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    printf("# %dx%d, %d drags of %d steps, down to %.2f of each side\n", w, h, BENCH_N_PHASES, steps, ratio);
+    printf("# mode mean_ms_per_step mean_ms_within_drag max_ms_per_step peak_lqr_bytes\n");
+    for (i = 0; i < BENCH_N_MODES; i++) {
+        res = bench_fork(image, w, h, steps, ratio, i);
+        if (!res.ok) {
+            fprintf(stderr, "%s: resize failed\n", mode_names[i]);
+            return 1;
+        }
+        printf("%s %.2f %.2f %.2f %zu\n", mode_names[i], res.total * 1e3 / res.n_steps,
+               res.inner * 1e3 / (res.n_steps - BENCH_N_PHASES), res.max * 1e3, res.peak);
+    }
+
+    free(image);
+    return 0;
+}
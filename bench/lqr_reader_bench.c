@@ -0,0 +1,214 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/* Renders a precomputed multisize image at many widths, as a
+ * responsive image service would, and reports the time taken to
+ * render them all: through the carver, resized to each width in
+ * turn and exported, and through readers (lqr_reader_new), each
+ * thread rendering its share of the widths with its own reader
+ * and no locks, and all at once (lqr_carver_export_widths, which
+ * fills every output in a single scan of the visibility map).
+ * The maps are computed once, down to the smallest width, before
+ * the timing starts.
+ *
+ * usage: lqr-reader-bench [width height widths ratio]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <lqr.h>
+#include "lqr_bench_util.h"
+
+#define BENCH_MAX_THREADS 8
+
+/* work shared by the rendering threads */
+typedef struct {
+    LqrCarver *r;
+    int h;
+    int n_widths;
+    const int *widths;
+    uint8_t **out;
+    int thread;
+    int n_threads;
+    int ok;
+} BenchJob;
+
+/* render the widths i, i + n_threads, ... with a reader */
+static void *
+bench_render(void *data)
+{
+    BenchJob *job = (BenchJob *) data;
+    LqrReader *rd;
+    int i, w1;
+
+    if ((rd = lqr_reader_new(job->r)) == NULL) {
+        return NULL;
+    }
+    for (i = job->thread; i < job->n_widths; i += job->n_threads) {
+        w1 = job->widths[i];
+        if ((lqr_reader_set_size(rd, w1, job->h) != LQR_OK)
+            || (lqr_reader_export(rd, job->out[i], (size_t) w1 * 3, LQR_COLDEPTH_8I, NULL) != LQR_OK)) {
+            lqr_reader_destroy(rd);
+            return NULL;
+        }
+    }
+    lqr_reader_destroy(rd);
+    job->ok = 1;
+    return NULL;
+}
+
+/* render all the widths with n_threads readers, returns the time
+ * taken or a negative value on failure */
+static double
+bench_readers(LqrCarver *r, int h, int n_widths, const int *widths, uint8_t **out, int n_threads)
+{
+    BenchJob jobs[BENCH_MAX_THREADS];
+    pthread_t threads[BENCH_MAX_THREADS];
+    double t0, t;
+    int i, ok = 1;
+
+    t0 = bench_now();
+    for (i = 0; i < n_threads; i++) {
+        jobs[i] = (BenchJob) { r, h, n_widths, widths, out, i, n_threads, 0 };
+        if (pthread_create(&threads[i], NULL, bench_render, &jobs[i]) != 0) {
+            return -1;
+        }
+    }
+    for (i = 0; i < n_threads; i++) {
+        pthread_join(threads[i], NULL);
+        ok = ok && jobs[i].ok;
+    }
+    t = bench_now() - t0;
+    return ok ? t : -1;
+}
+
+int
+main(int argc, char **argv)
+{
+    int w = 1600;
+    int h = 1200;
+    int n_widths = 32;
+    double ratio = 0.5;
+    uint8_t *image;
+    uint8_t **ref, **out;
+    int *widths;
+    LqrCarver *r;
+    double t0, t;
+    int i, n_threads;
+
+    if (argc == 5) {
+        w = atoi(argv[1]);
+        h = atoi(argv[2]);
+        n_widths = atoi(argv[3]);
+        ratio = atof(argv[4]);
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [width height widths ratio]\n", argv[0]);
+        return 1;
+    }
+    if ((w < 4) || (h < 1) || (n_widths < 1) || (ratio <= 0) || (ratio >= 1)) {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    /* the widths are spread evenly from w down to ratio * w */
+    widths = malloc(n_widths * sizeof(int));
+    ref = calloc(n_widths, sizeof(uint8_t *));
+    out = calloc(n_widths, sizeof(uint8_t *));
+    if ((widths == NULL) || (ref == NULL) || (out == NULL) || ((image = bench_noise_new(w, h, 12345)) == NULL)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < n_widths; i++) {
+        widths[i] = w - (int) ((w - w * ratio) * i / (n_widths > 1 ? n_widths - 1 : 1));
+        ref[i] = malloc((size_t) widths[i] * h * 3);
+        out[i] = malloc((size_t) widths[i] * h * 3);
+        if ((ref[i] == NULL) || (out[i] == NULL)) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+
+    r = lqr_carver_new(image, w, h, 3);
+    if ((r == NULL) || (lqr_carver_init(r, 1, 0) != LQR_OK) || (lqr_carver_resize(r, widths[n_widths - 1], h) != LQR_OK)) {
+        fprintf(stderr, "resize failed\n");
+        return 1;
+    }
+
+    printf("# %dx%d, %d widths down to %d\n", w, h, n_widths, widths[n_widths - 1]);
+    printf("# mode threads ms_total ms_per_width\n");
+
+    t0 = bench_now();
+    for (i = 0; i < n_widths; i++) {
+        if ((lqr_carver_resize(r, widths[i], h) != LQR_OK)
+            || (lqr_carver_export(r, ref[i], (size_t) widths[i] * 3, LQR_COLDEPTH_8I, NULL) != LQR_OK)) {
+            fprintf(stderr, "carver: render failed\n");
+            return 1;
+        }
+    }
+    t = bench_now() - t0;
+    printf("carver 1 %.2f %.3f\n", t * 1e3, t * 1e3 / n_widths);
+
+    for (n_threads = 1; n_threads <= BENCH_MAX_THREADS; n_threads *= 2) {
+        if ((t = bench_readers(r, h, n_widths, widths, out, n_threads)) < 0) {
+            fprintf(stderr, "readers: render failed\n");
+            return 1;
+        }
+        for (i = 0; i < n_widths; i++) {
+            if (memcmp(out[i], ref[i], (size_t) widths[i] * h * 3) != 0) {
+                fprintf(stderr, "readers: the image differs at width %d\n", widths[i]);
+                return 1;
+            }
+        }
+        printf("readers %d %.2f %.3f\n", n_threads, t * 1e3, t * 1e3 / n_widths);
+    }
+
+    /* all the widths in a single scan */
+    for (i = 0; i < n_widths; i++) {
+        memset(out[i], 0, (size_t) widths[i] * h * 3);
+    }
+    t0 = bench_now();
+    if (lqr_carver_export_widths(r, n_widths, widths, (void **) out, NULL, LQR_COLDEPTH_8I, NULL) != LQR_OK) {
+        fprintf(stderr, "series: render failed\n");
+        return 1;
+    }
+    t = bench_now() - t0;
+    for (i = 0; i < n_widths; i++) {
+        if (memcmp(out[i], ref[i], (size_t) widths[i] * h * 3) != 0) {
+            fprintf(stderr, "series: the image differs at width %d\n", widths[i]);
+            return 1;
+        }
+    }
+    printf("series 1 %.2f %.3f\n", t * 1e3, t * 1e3 / n_widths);
+
+    lqr_carver_destroy(r);
+    for (i = 0; i < n_widths; i++) {
+        free(ref[i]);
+        free(out[i]);
+    }
+    free(ref);
+    free(out);
+    free(widths);
+    return 0;
+}
@@ -0,0 +1,233 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/* Measures the readout of a resized image into an output buffer,
+ * pixel by pixel (lqr_carver_scan_ext), line by line through the
+ * readout buffer (lqr_carver_scan_line_ext), by spans read in
+ * place (lqr_carver_scan_spans), in a single call
+ * (lqr_carver_export), by tiles visited in a scattered order, as a
+ * tiled renderer would (lqr_carver_export_region), and by random
+ * access to each pixel (lqr_carver_get_pixel), and checks that they
+ * all give the same image. Both axes are resized, in both orders: the lines
+ * are the rows when the width is resized last, the columns when
+ * the height is.
+ *
+ * usage: lqr-readout-bench [width height ratio repeats]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <lqr.h>
+#include "lqr_bench_util.h"
+
+#define BENCH_N_MODES 6
+
+/* side of the tiles of the tiled readout */
+#define BENCH_TILE 64
+
+static int
+bench_gcd(int a, int b)
+{
+    int t;
+
+    while (b != 0) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* copy the pixels of a line (a row, or a column when the carver
+ * is transposed) into the output image */
+static void
+bench_put(uint8_t *out, int w1, bool by_row, int n, int x, const uint8_t *rgb, int length)
+{
+    int i;
+
+    if (by_row) {
+        memcpy(out + ((size_t) n * w1 + x) * 3, rgb, (size_t) length * 3);
+        return;
+    }
+    for (i = 0; i < length; i++) {
+        memcpy(out + ((size_t) (x + i) * w1 + n) * 3, rgb + (size_t) i * 3, 3);
+    }
+}
+
+/* mode 0: pixels, 1: lines, 2: spans, 3: export, 4: tiles, 5: getpixel */
+static void
+bench_readout(LqrCarver *r, uint8_t *out, int mode)
+{
+    int w1 = lqr_carver_get_width(r);
+    int h1 = lqr_carver_get_height(r);
+    bool by_row = lqr_carver_scan_by_row(r);
+    int x, y, n, n_spans, i;
+    int tiles_x, n_tiles, step;
+    void *rgb;
+    LqrSpan *spans;
+
+    lqr_carver_scan_reset(r);
+    switch (mode) {
+        case 0:
+            while (lqr_carver_scan_ext(r, &x, &y, &rgb)) {
+                memcpy(out + ((size_t) y * w1 + x) * 3, rgb, 3);
+            }
+            break;
+        case 1:
+            while (lqr_carver_scan_line_ext(r, &n, &rgb)) {
+                bench_put(out, w1, by_row, n, 0, rgb, by_row ? w1 : lqr_carver_get_height(r));
+            }
+            break;
+        case 2:
+            while (lqr_carver_scan_spans(r, &n, &spans, &n_spans)) {
+                for (i = 0; i < n_spans; i++) {
+                    bench_put(out, w1, by_row, n, spans[i].x, spans[i].rgb, spans[i].length);
+                }
+            }
+            break;
+        case 3:
+            lqr_carver_export(r, out, (size_t) w1 * 3, LQR_COLDEPTH_8I, NULL);
+            break;
+        case 4:
+            /* the tiles are visited with a stride coprime with their
+             * number, so that each one is far from the previous */
+            tiles_x = (w1 + BENCH_TILE - 1) / BENCH_TILE;
+            n_tiles = tiles_x * ((h1 + BENCH_TILE - 1) / BENCH_TILE);
+            for (step = n_tiles / 2 + 1; bench_gcd(step, n_tiles) != 1; step--) {
+            }
+            for (i = 0, n = 0; i < n_tiles; i++, n = (n + step) % n_tiles) {
+                x = (n % tiles_x) * BENCH_TILE;
+                y = (n / tiles_x) * BENCH_TILE;
+                lqr_carver_export_region(r, x, y, MIN(BENCH_TILE, w1 - x), MIN(BENCH_TILE, h1 - y),
+                                         out + ((size_t) y * w1 + x) * 3, (size_t) w1 * 3, LQR_COLDEPTH_8I, NULL);
+            }
+            break;
+        default:
+            for (y = 0; y < h1; y++) {
+                for (x = 0; x < w1; x++) {
+                    lqr_carver_get_pixel(r, x, y, &rgb);
+                    memcpy(out + ((size_t) y * w1 + x) * 3, rgb, 3);
+                }
+            }
+            break;
+    }
+}
+
+/* resize and time the readouts, returns 0 on failure */
+static int
+bench_run(uint8_t *image, int w, int h, int w1, int h1, LqrResizeOrder order, int repeats)
+{
+    static const char *mode_names[BENCH_N_MODES] = { "pixels", "lines", "spans", "export", "tiles", "getpixel" };
+    uint8_t *out[BENCH_N_MODES];
+    LqrCarver *r;
+    LqrSpan *spans;
+    int i, k, n, n_spans, n_lines;
+    long total_spans = 0;
+    double t0, t;
+
+    r = lqr_carver_new(image, w, h, 3);
+    if ((r == NULL) || (lqr_carver_init(r, 1, 0) != LQR_OK)) {
+        return 0;
+    }
+    lqr_carver_set_preserve_input_image(r);
+    lqr_carver_set_resize_order(r, order);
+    if (lqr_carver_resize(r, w1, h1) != LQR_OK) {
+        return 0;
+    }
+    for (k = 0; k < BENCH_N_MODES; k++) {
+        if ((out[k] = calloc((size_t) w1 * h1, 3)) == NULL) {
+            return 0;
+        }
+    }
+
+    n_lines = 0;
+    while (lqr_carver_scan_spans(r, &n, &spans, &n_spans)) {
+        total_spans += n_spans;
+        n_lines++;
+    }
+
+    printf("# by %s, %.1f spans per line\n", lqr_carver_scan_by_row(r) ? "rows" : "columns",
+           (double) total_spans / n_lines);
+    for (k = 0; k < BENCH_N_MODES; k++) {
+        t0 = bench_now();
+        for (i = 0; i < repeats; i++) {
+            bench_readout(r, out[k], k);
+        }
+        t = bench_now() - t0;
+        printf("%s %.3f\n", mode_names[k], t * 1e3 / repeats);
+        if (memcmp(out[k], out[0], (size_t) w1 * h1 * 3) != 0) {
+            fprintf(stderr, "%s: the image differs\n", mode_names[k]);
+            return 0;
+        }
+    }
+
+    for (k = 0; k < BENCH_N_MODES; k++) {
+        free(out[k]);
+    }
+    lqr_carver_destroy(r);
+    return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+    int w = 1600;
+    int h = 1200;
+    double ratio = 0.8;
+    int repeats = 20;
+    int w1, h1;
+    uint8_t *image;
+
+    if (argc == 5) {
+        w = atoi(argv[1]);
+        h = atoi(argv[2]);
+        ratio = atof(argv[3]);
+        repeats = atoi(argv[4]);
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [width height ratio repeats]\n", argv[0]);
+        return 1;
+    }
+    w1 = (int) (w * ratio + 0.5);
+    h1 = (int) (h * ratio + 0.5);
+    if ((w < 2) || (h < 2) || (repeats < 1) || (w1 < 1) || (h1 < 1)) {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    if ((image = bench_noise_new(w, h, 12345)) == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    printf("# %dx%d -> %dx%d\n", w, h, w1, h1);
+    printf("# mode ms_per_readout\n");
+    if (!bench_run(image, w, h, w1, h1, LQR_RES_ORDER_VERT, repeats)
+        || !bench_run(image, w, h, w1, h1, LQR_RES_ORDER_HOR, repeats)) {
+        fprintf(stderr, "readout failed\n");
+        return 1;
+    }
+
+    free(image);
+    return 0;
+}
@@ -0,0 +1,230 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/* Compares the approximate seam searches, i.e. the multi-seam
+ * passes (lqr_carver_set_seams_per_pass) and the multi-resolution
+ * search (lqr_carver_set_pyramid), with the exact one-seam-at-a-time
+ * carving: for each setting the image is reduced and the energy of
+ * the removed pixels (measured on the original image) is reported
+ * together with its drift from the exact result.
+ *
+ * usage: lqr-seams-bench [width height ratio]
+ * (the first setting must be the exact one)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lqr.h>
+#include "lqr_bench_util.h"
+
+enum {
+    BENCH_SEAMS_PER_PASS,
+    BENCH_PYRAMID
+};
+
+static const struct {
+    int mode;
+    int value;
+} bench_settings[] = {
+    { BENCH_SEAMS_PER_PASS, 1 },
+    { BENCH_SEAMS_PER_PASS, 2 },
+    { BENCH_SEAMS_PER_PASS, 4 },
+    { BENCH_SEAMS_PER_PASS, 8 },
+    { BENCH_SEAMS_PER_PASS, 16 },
+    { BENCH_SEAMS_PER_PASS, 32 },
+    { BENCH_SEAMS_PER_PASS, 64 },
+    { BENCH_PYRAMID, 2 },
+    { BENCH_PYRAMID, 4 },
+    { BENCH_PYRAMID, 8 }
+};
+
+static const char *bench_mode_names[] = { "seams_per_pass", "pyramid" };
+
+/* deterministic test image: smooth gradients, noise and a few
+ * sharp edges, so that the seams have something to avoid */
+static uint8_t *
+bench_image_new(int w, int h)
+{
+    uint8_t *buffer;
+    uint32_t seed = 12345;
+    int x, y, k;
+    int v;
+
+    buffer = malloc((size_t) w * h * 3);
+    if (buffer == NULL) {
+        return NULL;
+    }
+    for (y = 0; y < h; y++) {
+        for (x = 0; x < w; x++) {
+            for (k = 0; k < 3; k++) {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                v = (x * 255 / w + y * 127 / h + k * 40) % 256;
+                v = (v + (int) (seed % 24)) % 256;
+                if (((x / 64 + y / 48) % 5) == 0) {
+                    v = 255 - v;
+                }
+                buffer[((size_t) y * w + x) * 3 + k] = (uint8_t) v;
+            }
+        }
+    }
+    return buffer;
+}
+
+/* energy of the original image */
+static float *
+bench_energy_new(const uint8_t *image, int w, int h)
+{
+    LqrCarver *r;
+    uint8_t *buffer;
+    float *energy;
+
+    buffer = malloc((size_t) w * h * 3);
+    energy = malloc((size_t) w * h * sizeof(float));
+    if ((buffer == NULL) || (energy == NULL)) {
+        free(buffer);
+        free(energy);
+        return NULL;
+    }
+    memcpy(buffer, image, (size_t) w * h * 3);
+    r = lqr_carver_new(buffer, w, h, 3);
+    if ((r == NULL) || (lqr_carver_get_true_energy(r, energy, 0) != LQR_OK)) {
+        free(energy);
+        energy = NULL;
+    }
+    lqr_carver_destroy(r);
+    return energy;
+}
+
+/* reduce the image width to w1 with the given setting
+ * and compute the energy of the removed pixels */
+static int
+bench_run(const uint8_t *image, const float *energy, int w, int h, int w1, int mode, int value,
+          double *time, double *removed)
+{
+    LqrCarver *r;
+    LqrVMap *vmap;
+    uint8_t *buffer;
+    int *levels;
+    int i, level;
+    double t0;
+
+    buffer = malloc((size_t) w * h * 3);
+    if (buffer == NULL) {
+        return 1;
+    }
+    memcpy(buffer, image, (size_t) w * h * 3);
+    r = lqr_carver_new(buffer, w, h, 3);
+    if ((r == NULL) || (lqr_carver_init(r, 1, 0) != LQR_OK)) {
+        lqr_carver_destroy(r);
+        return 1;
+    }
+    if (((mode == BENCH_SEAMS_PER_PASS) && (lqr_carver_set_seams_per_pass(r, value) != LQR_OK))
+        || ((mode == BENCH_PYRAMID) && (lqr_carver_set_pyramid(r, value, 0) != LQR_OK))) {
+        lqr_carver_destroy(r);
+        return 1;
+    }
+
+    t0 = bench_now();
+    if (lqr_carver_resize(r, w1, h) != LQR_OK) {
+        lqr_carver_destroy(r);
+        return 1;
+    }
+    *time = bench_now() - t0;
+
+    /* pixels with a visibility level below the current one are hidden */
+    vmap = lqr_vmap_dump(r);
+    if (vmap == NULL) {
+        lqr_carver_destroy(r);
+        return 1;
+    }
+    levels = lqr_vmap_get_data(vmap);
+    level = w - w1 + 1;
+    *removed = 0;
+    for (i = 0; i < w * h; i++) {
+        if ((levels[i] > 0) && (levels[i] < level)) {
+            *removed += energy[i];
+        }
+    }
+
+    lqr_vmap_destroy(vmap);
+    lqr_carver_destroy(r);
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    int w = 800;
+    int h = 600;
+    double ratio = 0.6;
+    int w1;
+    uint8_t *image;
+    float *energy;
+    double time, removed, removed_exact = 0;
+    size_t i;
+
+    if (argc == 4) {
+        w = atoi(argv[1]);
+        h = atoi(argv[2]);
+        ratio = atof(argv[3]);
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [width height ratio]\n", argv[0]);
+        return 1;
+    }
+    w1 = (int) (w * ratio);
+    if ((w < 2) || (h < 1) || (w1 < 1) || (w1 >= w)) {
+        fprintf(stderr, "invalid sizes\n");
+        return 1;
+    }
+
+    image = bench_image_new(w, h);
+    energy = image ? bench_energy_new(image, w, h) : NULL;
+    if (energy == NULL) {
+        fprintf(stderr, "could not compute the image energy\n");
+        free(image);
+        return 1;
+    }
+
+    printf("# %dx%d -> %dx%d\n", w, h, w1, h);
+    printf("# mode value time_s seams_per_s removed_energy drift_pct\n");
+    for (i = 0; i < sizeof(bench_settings) / sizeof(bench_settings[0]); i++) {
+        if (bench_run(image, energy, w, h, w1, bench_settings[i].mode, bench_settings[i].value, &time, &removed)) {
+            fprintf(stderr, "resize failed\n");
+            free(image);
+            free(energy);
+            return 1;
+        }
+        if (i == 0) {
+            removed_exact = removed;
+        }
+        printf("%s %d %.3f %.1f %.3f %.2f\n", bench_mode_names[bench_settings[i].mode], bench_settings[i].value,
+               time, (w - w1) / time, removed,
+               removed_exact > 0 ? 100 * (removed - removed_exact) / removed_exact : 0);
+    }
+
+    free(image);
+    free(energy);
+    return 0;
+}
@@ -29,17 +29,25 @@ extern "C" {
 #endif
 
 #include <lqr_base.h>
+#include <lqr_mem_pub.h>
 #include <lqr_gradient_pub.h>
 #include <lqr_rwindow_pub.h>
 #include <lqr_energy_pub.h>
 #include <lqr_cursor_pub.h>
 #include <lqr_progress_pub.h>
+#include <lqr_thread_pool_pub.h>
+#include <lqr_minpath_pub.h>
+#include <lqr_cpu_pub.h>
+#include <lqr_stats_pub.h>
 #include <lqr_vmap_pub.h>
 #include <lqr_vmap_list_pub.h>
 #include <lqr_carver_list_pub.h>
 #include <lqr_carver_bias_pub.h>
 #include <lqr_carver_rigmask_pub.h>
+#include <lqr_carver_pyramid_pub.h>
+#include <lqr_carver_dual_pub.h>
 #include <lqr_carver_pub.h>
+#include <lqr_reader_pub.h>
 
 #ifdef __cplusplus
 }
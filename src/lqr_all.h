@@ -28,17 +28,25 @@ extern "C" {
 #endif
 
 #include "lqr_base.h"
+#include "lqr_mem.h"
 #include "lqr_gradient.h"
 #include "lqr_rwindow.h"
 #include "lqr_energy.h"
 #include "lqr_cursor.h"
 #include "lqr_progress.h"
+#include "lqr_thread_pool.h"
+#include "lqr_minpath.h"
+#include "lqr_cpu.h"
+#include "lqr_stats.h"
 #include "lqr_vmap.h"
 #include "lqr_vmap_list.h"
 #include "lqr_carver_list.h"
 #include "lqr_carver_bias.h"
 #include "lqr_carver_rigmask.h"
+#include "lqr_carver_pyramid.h"
+#include "lqr_carver_dual.h"
 #include "lqr_carver.h"
+#include "lqr_reader.h"
 
 #ifdef __cplusplus
 }
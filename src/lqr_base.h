@@ -51,6 +51,11 @@
 #  define LQR_PUBLIC
 #endif /* G_OS_WIN32 */
 
+/* x86 vector kernels (selected at runtime) */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define LQR_HAVE_X86_SIMD
+#endif /* __GNUC__ && x86 */
+
 #if 0
 #define __LQR_DEBUG__
 #endif
@@ -81,10 +86,11 @@ typedef enum _LqrRetVal LqrRetVal;
 #else
 #define LQR_DEPRECATED
 #endif
-/* g_try_new and g_try_new0 replacement */
-#define LRQ_CALLOC(type, count) calloc(count, sizeof(type))
-/* g_free replacement */
-#define LRQ_FREE(ptr) ((ptr) ? (void)0 : free(ptr))
+/* g_try_new0 replacement (the functions are in lqr_mem.h) */
+#define LRQ_CALLOC(type, count) ((type *) lqr_mem_calloc((count), sizeof(type), NULL))
+/* g_free replacement; the pointer is cleared so that a map
+ * released during a failed reallocation is not freed twice */
+#define LRQ_FREE(ptr) do { lqr_mem_free(ptr); (ptr) = NULL; } while (0)
 
 /* generic signal processing macros */
 #define LQR_CATCH(expr) do { \
@@ -25,7 +25,8 @@
 #endif
 
 #include <math.h>
-#include <unistd.h>
+#include <limits.h>
+#include <string.h>
 
 #include "lqr_all.h"
 
@@ -51,8 +52,7 @@ lqr_carver_new_common(int width, int height, int channels)
     LQR_TRY_N_N(r = LRQ_CALLOC(LqrCarver, 1));
 
     atomic_init(&r->state, LQR_CARVER_STATE_STD);
-    atomic_init(&r->state_lock, 0);
-    atomic_init(&r->state_lock_queue, 0);
+    pthread_mutex_init(&r->state_lock, NULL);
 
     r->level = 1;
     r->max_level = 1;
@@ -76,6 +76,7 @@ lqr_carver_new_common(int width, int height, int channels)
     r->bias = NULL;
     r->m = NULL;
     r->least = NULL;
+    r->least_dx = NULL;
     r->_raw = NULL;
     r->raw = NULL;
     r->vpath = NULL;
@@ -83,6 +84,8 @@ lqr_carver_new_common(int width, int height, int channels)
     r->rigidity_map = NULL;
     r->rigidity_mask = NULL;
     r->delta_x = 1;
+    r->minpath_row = NULL;
+    lqr_cpu_get_kernels(&r->kernels);
 
     r->h = height;
     r->w = width;
@@ -95,19 +98,31 @@ lqr_carver_new_common(int width, int height, int channels)
 
     r->rcache = NULL;
     r->use_rcache = true;
+    r->compact = false;
+    r->minpath_row = r->kernels.minpath_row_dx1;
 
     r->rwindow = NULL;
     lqr_carver_set_energy_function_builtin(r, LQR_EF_GRAD_XABS);
     r->nrg_xmin = NULL;
     r->nrg_xmax = NULL;
+    r->carved_xmin = NULL;
+    r->carved_xmax = NULL;
     r->nrg_uptodate = false;
 
+    r->n_threads = 1;
+    r->pool = NULL;
+
+    r->seams_per_pass = 1;
+    r->pyramid_factor = 1;
+    r->dual.active = -1;
+    r->pyramid_band = 0;
+
     r->leftright = 0;
     r->lr_switch_frequency = 0;
 
     r->enl_step = 2.0;
 
-    LQR_TRY_N_N(r->vs = LRQ_CALLOC(int, r->w * r->h));
+    LQR_TRY_N_N(r->vs = LQR_CARVER_CALLOC(r, int, r->w * r->h));
 
     /* initialize cursor */
 
@@ -153,31 +168,249 @@ lqr_carver_new_ext(void *buffer, int width, int height, int channels, LqrColDept
     LQR_TRY_N_N(r = lqr_carver_new_common(width, height, channels));
 
     r->rgb = (void *) buffer;
+    r->rgb_user = true;
 
-    BUF_TRY_NEW_RET_POINTER(r->rgb_ro_buffer, r->channels * r->w, colour_depth);
+    BUF_TRY_NEW_RET_POINTER(r, r->rgb_ro_buffer, r->channels * r->w, colour_depth);
 
     r->col_depth = colour_depth;
 
     return r;
 }
 
+/* reinitialize the carver for a new image with the same number
+ * of channels and colour depth, keeping the settings (energy function,
+ * rigidity, resize order, threads, ...) and reusing the maps (they
+ * only grow if the new image is larger); the buffer is then owned by
+ * the carver, as in lqr_carver_new, and must not be freed by the
+ * caller (the previous one is freed, unless it was flagged to be
+ * preserved, and the flag is cleared). Everything tied to the previous
+ * image is dropped: bias, rigidity mask, brightness cache, dumped
+ * visibility maps, multi-resolution search state and dual cache;
+ * the statistics keep accumulating. Carvers with attached carvers
+ * cannot be reset. If an error is returned the carver can only be
+ * destroyed */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_reset(LqrCarver *r, void *buffer, int width, int height)
+{
+    LqrCarverState state = atomic_load(&r->state);
+    int x, y;
+
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_F(r->attached_list == NULL);
+    LQR_CATCH_F((state == LQR_CARVER_STATE_STD) || (state == LQR_CARVER_STATE_CANCELLED));
+    LQR_CATCH_F((buffer != NULL) && (width > 0) && (height > 0));
+
+    /* clear a previous cancellation */
+    LQR_CATCH(lqr_carver_set_state(r, LQR_CARVER_STATE_STD, false));
+
+    /* the old image is kept as a spare unless it was the user's */
+    lqr_carver_rgb_replace(r, buffer);
+    r->rgb_user = true;
+
+    /* drop what belongs to the previous image */
+    LRQ_FREE(r->bias);
+    LRQ_FREE(r->rigidity_mask);
+    LRQ_FREE(r->rcache);
+    lqr_vmap_list_destroy(r->flushed_vs);
+    r->flushed_vs = NULL;
+    lqr_carver_pyramid_clear(&r->pyramid);
+    lqr_carver_dual_clear(r);
+
+    r->w = width;
+    r->h = height;
+    r->w0 = r->w;
+    r->h0 = r->h;
+    r->w_start = r->w;
+    r->h_start = r->h;
+    r->level = 1;
+    r->max_level = 1;
+    r->transposed = 0;
+    r->leftright = 0;
+    r->nrg_uptodate = false;
+    r->session_rescale_total = 0;
+    r->session_rescale_current = 0;
+
+    LQR_CATCH_MEM(r->vs = LQR_CARVER_RESERVE0(r, r->vs, int, r->w * r->h));
+    r->vs_serial++;
+    BUF_TRY_RESERVE_RET_LQR(r, r->rgb_ro_buffer, r->rgb_ro_buffer, r->w * r->channels, r->col_depth);
+
+    if (r->nrg_active) {
+        LQR_CATCH_MEM(r->en = LQR_CARVER_RESERVE(r, r->en, float, r->w * r->h));
+        LQR_CATCH_MEM(r->_raw = LQR_CARVER_RESERVE(r, r->_raw, int, r->w * r->h));
+        LQR_CATCH_MEM(r->raw = LQR_CARVER_RESERVE(r, r->raw, int *, r->h));
+        for (y = 0; y < height; y++) {
+            r->raw[y] = r->_raw + y * width;
+        }
+        for (x = 0; x < width * height; x++) {
+            r->_raw[x] = x;
+        }
+    }
+
+    if (r->active) {
+        LQR_CATCH_MEM(r->m = LQR_CARVER_RESERVE(r, r->m, float, r->w * r->h));
+        LQR_CATCH(lqr_carver_alloc_least(r, r->w * r->h));
+        LQR_CATCH_MEM(r->vpath = LQR_CARVER_RESERVE0(r, r->vpath, int, r->h));
+        LQR_CATCH_MEM(r->vpath_x = LQR_CARVER_RESERVE0(r, r->vpath_x, int, r->h));
+        LQR_CATCH_MEM(r->nrg_xmin = LQR_CARVER_RESERVE0(r, r->nrg_xmin, int, r->h));
+        LQR_CATCH_MEM(r->nrg_xmax = LQR_CARVER_RESERVE0(r, r->nrg_xmax, int, r->h));
+        LQR_CATCH_MEM(r->carved_xmin = LQR_CARVER_RESERVE0(r, r->carved_xmin, int, r->h));
+        LQR_CATCH_MEM(r->carved_xmax = LQR_CARVER_RESERVE0(r, r->carved_xmax, int, r->h));
+
+        /* the rigidity depends on the height */
+        lqr_carver_rigidity_map_fill(r);
+    }
+
+    lqr_cursor_reset(r->c);
+
+    return LQR_OK;
+}
+
+/* create a carver for the same image, at the same size and with the
+ * same settings, which can then be resized independently of r: the
+ * image, bias, rigidity mask and visibility map computed so far are
+ * shared between them and only copied by the first one which needs
+ * to modify them (e.g. to go deeper than the shared visibility map),
+ * so that several sizes can be reached from a single computation of
+ * the maps (each clone can be used from a different thread). The
+ * dumped visibility maps and the dual cache are not cloned, and
+ * carvers with attached carvers cannot be cloned. Unless it was
+ * flagged to be preserved, the buffer given to lqr_carver_new is
+ * freed, since r then works on a copy of it (which is shared) */
+/* LQR_PUBLIC */
+LqrCarver *
+lqr_carver_clone(LqrCarver *r)
+{
+    LqrCarver *r2;
+    void *rgb = NULL;
+
+    LQR_CATCH_CANC_N(r);
+    if ((r->root != NULL) || (r->attached_list != NULL) || (atomic_load(&r->state) != LQR_CARVER_STATE_STD)) {
+        return NULL;
+    }
+
+    /* the user's buffer cannot be shared */
+    if (r->rgb_user || r->preserve_in_buffer) {
+        BUF_TRY_NEW_RET_POINTER(r, rgb, r->w0 * r->h0 * r->channels, r->col_depth);
+        memcpy(rgb, r->rgb, (size_t) r->w0 * r->h0 * r->channels * PXL_SIZE(r->col_depth));
+        lqr_carver_rgb_replace(r, rgb);
+    }
+
+    LQR_TRY_N_N(r2 = lqr_carver_new_common(r->w0, r->h0, r->channels));
+    if (lqr_carver_clone_maps(r2, r) != LQR_OK) {
+        lqr_carver_destroy(r2);
+        return NULL;
+    }
+
+    return r2;
+}
+
+/* set up a new carver as a clone of src (see lqr_carver_clone):
+ * the energy and minpath maps are not shared, they are recomputed
+ * if the clone needs to go deeper (as src would do) */
+LqrRetVal
+lqr_carver_clone_maps(LqrCarver *r, LqrCarver *src)
+{
+    int x, y;
+
+    /* settings */
+    r->image_type = src->image_type;
+    r->alpha_channel = src->alpha_channel;
+    r->black_channel = src->black_channel;
+    r->col_depth = src->col_depth;
+    r->resize_aux_layers = src->resize_aux_layers;
+    r->dump_vmaps = src->dump_vmaps;
+    r->resize_order = src->resize_order;
+    r->lr_switch_frequency = src->lr_switch_frequency;
+    r->enl_step = src->enl_step;
+    *r->progress = *src->progress;
+    r->session_update_step = src->session_update_step;
+    r->use_rcache = src->use_rcache;
+    r->compact = src->compact;
+    r->seams_per_pass = src->seams_per_pass;
+    r->pyramid_factor = src->pyramid_factor;
+    r->pyramid_band = src->pyramid_band;
+    r->mem.limit = src->mem.limit;
+    LQR_CATCH(lqr_carver_set_energy_function(r, src->nrg, src->nrg_radius, src->nrg_read_t, src->nrg_extra_data));
+    if (src->n_threads > 1) {
+        LQR_CATCH(lqr_carver_set_n_threads(r, src->n_threads));
+    }
+
+    /* geometry */
+    r->w_start = src->w_start;
+    r->h_start = src->h_start;
+    r->w = src->w;
+    r->h = src->h;
+    r->level = src->level;
+    r->max_level = src->max_level;
+    r->transposed = src->transposed;
+    r->leftright = src->leftright;
+
+    /* shared maps */
+    LRQ_FREE(r->vs);
+    r->vs = lqr_mem_share(src->vs);
+    r->rgb = lqr_mem_share(src->rgb);
+    r->rgb_user = false;
+    r->bias = lqr_mem_share(src->bias);
+    r->rigidity_mask = lqr_mem_share(src->rigidity_mask);
+    r->_raw = lqr_mem_share(src->_raw);
+
+    BUF_TRY_NEW0_RET_LQR(r, r->rgb_ro_buffer, r->w0 * r->channels, r->col_depth);
+
+    if (src->nrg_active) {
+        LQR_CATCH_MEM(r->en = LQR_CARVER_CALLOC(r, float, r->w0 * r->h0));
+        LQR_CATCH_MEM(r->raw = LQR_CARVER_CALLOC(r, int *, r->h_start));
+        for (y = 0; y < r->h_start; y++) {
+            r->raw[y] = r->_raw + (src->raw[y] - src->_raw);
+        }
+        r->nrg_active = true;
+    }
+
+    if (src->active) {
+        LQR_CATCH_MEM(r->m = LQR_CARVER_CALLOC(r, float, r->w0 * r->h0));
+        LQR_CATCH(lqr_carver_alloc_least(r, r->w0 * r->h0));
+        LQR_CATCH_MEM(r->vpath = LQR_CARVER_CALLOC(r, int, r->h0));
+        LQR_CATCH_MEM(r->vpath_x = LQR_CARVER_CALLOC(r, int, r->h0));
+        LQR_CATCH_MEM(r->nrg_xmin = LQR_CARVER_CALLOC(r, int, r->h0));
+        LQR_CATCH_MEM(r->nrg_xmax = LQR_CARVER_CALLOC(r, int, r->h0));
+        LQR_CATCH_MEM(r->carved_xmin = LQR_CARVER_CALLOC(r, int, r->h0));
+        LQR_CATCH_MEM(r->carved_xmax = LQR_CARVER_CALLOC(r, int, r->h0));
+
+        r->delta_x = src->delta_x;
+        r->rigidity = src->rigidity;
+        LQR_CATCH_MEM(r->rigidity_map = LQR_CARVER_CALLOC(r, float, 2 * r->delta_x + 1));
+        r->rigidity_map += r->delta_x;
+        for (x = -r->delta_x; x <= r->delta_x; x++) {
+            r->rigidity_map[x] = src->rigidity_map[x];
+        }
+        r->minpath_row = src->minpath_row;
+        r->active = true;
+    }
+
+    r->nrg_uptodate = false;
+    lqr_cursor_reset(r->c);
+
+    return LQR_OK;
+}
+
 /* destructor */
 /* LQR_PUBLIC */
 void
 lqr_carver_destroy(LqrCarver *r)
 {
-    if (!r->preserve_in_buffer) {
-        LRQ_FREE(r->rgb);
-    }
+    lqr_carver_dual_free(r);
+    lqr_carver_rgb_free(r);
     if (r->root == NULL) {
         LRQ_FREE(r->vs);
     }
     LRQ_FREE(r->rgb_ro_buffer);
+    LRQ_FREE(r->spans);
     LRQ_FREE(r->en);
     LRQ_FREE(r->bias);
     LRQ_FREE(r->m);
     LRQ_FREE(r->rcache);
     LRQ_FREE(r->least);
+    LRQ_FREE(r->least_dx);
     lqr_cursor_destroy(r->c);
     LRQ_FREE(r->vpath);
     LRQ_FREE(r->vpath_x);
@@ -187,13 +420,26 @@ lqr_carver_destroy(LqrCarver *r)
     }
     LRQ_FREE(r->rigidity_mask);
     lqr_rwindow_destroy(r->rwindow);
+    lqr_thread_pool_destroy(r->pool);
     LRQ_FREE(r->nrg_xmin);
     LRQ_FREE(r->nrg_xmax);
+    LRQ_FREE(r->carved_xmin);
+    LRQ_FREE(r->carved_xmax);
+    lqr_carver_pyramid_clear(&r->pyramid);
     lqr_vmap_list_destroy(r->flushed_vs);
     lqr_carver_list_destroy(r->attached_list);
     LRQ_FREE(r->progress);
     LRQ_FREE(r->_raw);
     LRQ_FREE(r->raw);
+    LRQ_FREE(r->rgb_spare);
+    LRQ_FREE(r->vs_spare);
+    LRQ_FREE(r->bias_spare);
+    LRQ_FREE(r->rigmask_spare);
+    pthread_mutex_destroy(&r->state_lock);
+#ifdef __LQR_DEBUG__
+    /* all the accounted memory must have been returned */
+    assert(atomic_load(&r->mem.live) == 0);
+#endif /* __LQR_DEBUG__ */
     LRQ_FREE(r);
 }
 
@@ -207,9 +453,13 @@ lqr_carver_init_energy_related(LqrCarver *r)
     LQR_CATCH_F(r->active == false);
     LQR_CATCH_F(r->nrg_active == false);
 
-    LQR_CATCH_MEM(r->en = LRQ_CALLOC(float, r->w * r->h));
-    LQR_CATCH_MEM(r->_raw = LRQ_CALLOC(int, r->h_start * r->w_start));
-    LQR_CATCH_MEM(r->raw = LRQ_CALLOC(int *, r->h_start));
+    /* maps left by a failed attempt are dropped */
+    LRQ_FREE(r->en);
+    LRQ_FREE(r->_raw);
+    LRQ_FREE(r->raw);
+    LQR_CATCH_MEM(r->en = LQR_CARVER_CALLOC(r, float, r->w * r->h));
+    LQR_CATCH_MEM(r->_raw = LQR_CARVER_CALLOC(r, int, r->h_start * r->w_start));
+    LQR_CATCH_MEM(r->raw = LQR_CARVER_CALLOC(r, int *, r->h_start));
 
     for (y = 0; y < r->h; y++) {
         r->raw[y] = r->_raw + y * r->w_start;
@@ -227,37 +477,67 @@ lqr_carver_init_energy_related(LqrCarver *r)
 LqrRetVal
 lqr_carver_init(LqrCarver *r, int delta_x, float rigidity)
 {
-    int x;
-
     LQR_CATCH_CANC(r);
 
     LQR_CATCH_F(r->active == false);
+    LQR_CATCH_F(!r->compact || (delta_x <= INT8_MAX));
 
     if (r->nrg_active == false) {
         LQR_CATCH(lqr_carver_init_energy_related(r));
     }
 
     /* LQR_CATCH_MEM (r->bias = LRQ_CALLOC (float, r->w * r->h)); */
-    LQR_CATCH_MEM(r->m = LRQ_CALLOC(float, r->w * r->h));
-    LQR_CATCH_MEM(r->least = LRQ_CALLOC(int, r->w * r->h));
+    LQR_CATCH_MEM(r->m = LQR_CARVER_CALLOC(r, float, r->w * r->h));
+    LQR_CATCH(lqr_carver_alloc_least(r, r->w * r->h));
 
-    LQR_CATCH_MEM(r->vpath = LRQ_CALLOC(int, r->h));
-    LQR_CATCH_MEM(r->vpath_x = LRQ_CALLOC(int, r->h));
+    LQR_CATCH_MEM(r->vpath = LQR_CARVER_CALLOC(r, int, r->h));
+    LQR_CATCH_MEM(r->vpath_x = LQR_CARVER_CALLOC(r, int, r->h));
 
-    LQR_CATCH_MEM(r->nrg_xmin = LRQ_CALLOC(int, r->h));
-    LQR_CATCH_MEM(r->nrg_xmax = LRQ_CALLOC(int, r->h));
+    LQR_CATCH_MEM(r->nrg_xmin = LQR_CARVER_CALLOC(r, int, r->h));
+    LQR_CATCH_MEM(r->nrg_xmax = LQR_CARVER_CALLOC(r, int, r->h));
+    LQR_CATCH_MEM(r->carved_xmin = LQR_CARVER_CALLOC(r, int, r->h));
+    LQR_CATCH_MEM(r->carved_xmax = LQR_CARVER_CALLOC(r, int, r->h));
 
     /* set rigidity map */
     r->delta_x = delta_x;
     r->rigidity = rigidity;
 
-    r->rigidity_map = LRQ_CALLOC(float, 2 * r->delta_x + 1);
+    r->rigidity_map = LQR_CARVER_CALLOC(r, float, 2 * r->delta_x + 1);
     r->rigidity_map += r->delta_x;
+    lqr_carver_rigidity_map_fill(r);
+
+    r->minpath_row = (r->delta_x == 1 ? r->kernels.minpath_row_dx1 : lqr_minpath_row_scalar);
+
+    r->active = true;
+
+    return LQR_OK;
+}
+
+/* set the rigidity function, which grows as |x|^1.5 with the
+ * seam displacement x and is scaled by the current height */
+void
+lqr_carver_rigidity_map_fill(LqrCarver *r)
+{
+    int x;
+
     for (x = -r->delta_x; x <= r->delta_x; x++) {
-        r->rigidity_map[x] = r->rigidity * powf(fabsf(x), 1.5) / r->h;
+        r->rigidity_map[x] = r->rigidity * powf(fabsf((float) x), 1.5) / r->h;
     }
+}
 
-    r->active = true;
+/* allocate the seam predecessors map: these are stored as
+ * absolute data indices, or as column offsets (one byte each)
+ * with the compact layout */
+LqrRetVal
+lqr_carver_alloc_least(LqrCarver *r, int size)
+{
+    if (r->compact) {
+        LRQ_FREE(r->least);
+        LQR_CATCH_MEM(r->least_dx = LQR_CARVER_RESERVE(r, r->least_dx, int8_t, size));
+    } else {
+        LRQ_FREE(r->least_dx);
+        LQR_CATCH_MEM(r->least = LQR_CARVER_RESERVE(r, r->least, int, size));
+    }
 
     return LQR_OK;
 }
@@ -451,6 +731,8 @@ lqr_carver_attach(LqrCarver *r, LqrCarver *aux)
     LQR_CATCH_F(atomic_load(&r->state) == LQR_CARVER_STATE_STD);
     LQR_CATCH_F(atomic_load(&aux->state) == LQR_CARVER_STATE_STD);
     LQR_CATCH_MEM(r->attached_list = lqr_carver_list_append(r->attached_list, aux));
+    /* the attached carver has no states set aside */
+    lqr_carver_dual_clear(r);
     LRQ_FREE(aux->vs);
     aux->vs = r->vs;
     aux->root = r;
@@ -522,6 +804,116 @@ lqr_carver_set_progress(LqrCarver *r, LqrProgress * p)
     r->progress = p;
 }
 
+/* free the image buffer, unless it is the input
+ * buffer and it was flagged to be preserved */
+void
+lqr_carver_rgb_free(LqrCarver *r)
+{
+    if (r->preserve_in_buffer) {
+        return;
+    }
+    if (r->rgb_user) {
+        LQR_USER_FREE(r->rgb);
+    } else {
+        LRQ_FREE(r->rgb);
+    }
+    r->rgb = NULL;
+}
+
+/* replace the image buffer, keeping the old one for reuse
+ * unless it was given by the user */
+void
+lqr_carver_rgb_replace(LqrCarver *r, void *rgb)
+{
+    if (r->preserve_in_buffer || r->rgb_user) {
+        lqr_carver_rgb_free(r);
+    } else {
+        lqr_carver_maps_spare(r, r->rgb, NULL, NULL, NULL);
+    }
+    r->rgb = rgb;
+    r->rgb_user = false;
+    r->preserve_in_buffer = false;
+    r->rgb_serial++;
+}
+
+/* keep the maps which are no longer needed (replaced ones, or the
+ * ones being built by an interrupted reallocation) for the next
+ * flatten, transpose or inflate (NULL maps are skipped) */
+void
+lqr_carver_maps_spare(LqrCarver *r, void *rgb, int *vs, float *bias, float *rigmask)
+{
+    if (rgb != NULL) {
+        LRQ_FREE(r->rgb_spare);
+        r->rgb_spare = rgb;
+    }
+    if (vs != NULL) {
+        LRQ_FREE(r->vs_spare);
+        r->vs_spare = vs;
+    }
+    if (bias != NULL) {
+        LRQ_FREE(r->bias_spare);
+        r->bias_spare = bias;
+    }
+    if (rigmask != NULL) {
+        LRQ_FREE(r->rigmask_spare);
+        r->rigmask_spare = rigmask;
+    }
+}
+
+/* reuse or grow a map (see lqr_mem_reserve) */
+void *
+lqr_carver_reserve(LqrCarver *r, void *ptr, size_t count, size_t size, bool zero)
+{
+    void *buf;
+    size_t capacity = lqr_mem_capacity(ptr);
+
+    buf = lqr_mem_reserve(ptr, count, size, zero, &r->mem);
+    if ((buf != NULL) && (count * size > capacity)) {
+        LQR_STATS_COUNT(r, bytes_allocated, lqr_mem_capacity(buf));
+    }
+    return buf;
+}
+
+/* get a map which is about to be modified in place: if it is shared
+ * with a clone it is replaced by a private copy (see lqr_mem_unshare) */
+void *
+lqr_carver_unshare(LqrCarver *r, void *ptr)
+{
+    void *buf;
+
+    buf = lqr_mem_unshare(ptr, &r->mem);
+    if ((buf != NULL) && (buf != ptr)) {
+        LQR_STATS_COUNT(r, bytes_allocated, lqr_mem_capacity(buf));
+    }
+    return buf;
+}
+
+/* make the maps which are modified while building the visibility
+ * map (the map itself and the raw rows) private to the carver */
+LqrRetVal
+lqr_carver_unshare_vsmap(LqrCarver *r)
+{
+    int *raw;
+    int y;
+
+    if (lqr_mem_is_shared(r->_raw)) {
+        LQR_CATCH_MEM(raw = LQR_CARVER_RESERVE(r, NULL, int, lqr_mem_capacity(r->_raw) / sizeof(int)));
+        memcpy(raw, r->_raw, lqr_mem_capacity(r->_raw));
+        for (y = 0; y < r->h_start; y++) {
+            r->raw[y] = raw + LQR_MAP_ROW(r, y);
+        }
+        LRQ_FREE(r->_raw);
+        r->_raw = raw;
+    }
+    if (lqr_mem_is_shared(r->vs)) {
+        LQR_CARVER_UNSHARE_RET_LQR(r, r->vs);
+        r->vs_serial++;
+        LQR_CATCH(lqr_carver_propagate_vsmap(r));
+    }
+
+    return LQR_OK;
+}
+
 /* flag the input buffer to avoid destruction */
 /* LQR_PUBLIC */
 void
@@ -530,6 +922,77 @@ lqr_carver_set_preserve_input_image(LqrCarver *r)
     r->preserve_in_buffer = true;
 }
 
+/* switch the energy related maps to the compact layout,
+ * in which they are stored densely packed by rows and the
+ * seams are physically removed from them while carving;
+ * the seam predecessors are then stored as column offsets,
+ * which requires delta_x to fit in one byte */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_compact_layout(LqrCarver *r, bool compact)
+{
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_CANC(r);
+    LQR_CATCH_F(atomic_load(&r->state) == LQR_CARVER_STATE_STD);
+
+    if (compact != r->compact) {
+        LQR_CATCH_F(!compact || !r->active || (r->delta_x <= INT8_MAX));
+        /* the maps contents are laid out differently */
+        LRQ_FREE(r->rcache);
+        r->rcache = NULL;
+        r->nrg_uptodate = false;
+        r->compact = compact;
+        if (r->active) {
+            LRQ_FREE(r->least);
+            LRQ_FREE(r->least_dx);
+            LQR_CATCH(lqr_carver_alloc_least(r, r->w0 * r->h0));
+        }
+    }
+
+    return LQR_OK;
+}
+
+/* set the number of threads used for maps computation
+ * (1 means no extra threads); custom energy functions
+ * must be reentrant in order to use more than one */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_n_threads(LqrCarver *r, int n_threads)
+{
+    LQR_CATCH_F(n_threads >= 1);
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_CANC(r);
+    LQR_CATCH_F(atomic_load(&r->state) == LQR_CARVER_STATE_STD);
+
+    lqr_thread_pool_destroy(r->pool);
+    r->pool = NULL;
+    r->n_threads = 1;
+
+    if (n_threads > 1) {
+        LQR_CATCH_MEM(r->pool = lqr_thread_pool_new(n_threads));
+        r->n_threads = r->pool->n_threads;
+    }
+
+    return LQR_OK;
+}
+
+/* set the number of seams extracted from each minpath map:
+ * with more than one the energy and minpath maps are only updated
+ * once per pass, which is faster but gives approximate results */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_seams_per_pass(LqrCarver *r, int seams_per_pass)
+{
+    LQR_CATCH_F(seams_per_pass >= 1);
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_CANC(r);
+    LQR_CATCH_F(atomic_load(&r->state) == LQR_CARVER_STATE_STD);
+
+    r->seams_per_pass = seams_per_pass;
+
+    return LQR_OK;
+}
+
 /*** compute maps (energy, minpath & visibility) ***/
 
 /* build multisize image up to given depth
@@ -556,7 +1019,9 @@ lqr_carver_build_maps(LqrCarver *r, int depth)
         LQR_CATCH(lqr_carver_build_emap(r));
         LQR_CATCH(lqr_carver_build_mmap(r));
 
-        /* compute visibility map */
+        /* compute visibility map (the maps shared
+         * with the clones are copied first) */
+        LQR_CATCH(lqr_carver_unshare_vsmap(r));
         LQR_CATCH(lqr_carver_build_vsmap(r, depth));
     }
     return LQR_OK;
@@ -566,34 +1031,107 @@ lqr_carver_build_maps(LqrCarver *r, int depth)
 LqrRetVal
 lqr_carver_build_emap(LqrCarver *r)
 {
-    int x, y;
-
     LQR_CATCH_CANC(r);
 
     if (r->nrg_uptodate) {
         return LQR_OK;
     }
 
+    LQR_STATS_TIMER(t0);
+
     if (r->use_rcache && r->rcache == NULL) {
-        LQR_CATCH_MEM(r->rcache = lqr_carver_generate_rcache(r));
+        r->rcache = lqr_carver_generate_rcache(r);
+        /* the generation stops early (returning NULL) if cancelled */
+        LQR_CATCH_CANC(r);
+        LQR_CATCH_MEM(r->rcache);
     }
 
-    for (y = 0; y < r->h; y++) {
+    if (r->pool != NULL) {
+        LQR_CATCH(lqr_carver_build_emap_threaded(r));
+    } else {
+        LQR_CATCH(lqr_carver_build_emap_rows(r, r->rwindow, 0, r->h));
+    }
+
+    r->nrg_uptodate = true;
+    LQR_STATS_PHASE(r, LQR_STATS_BUILD_EMAP, t0);
+
+    return LQR_OK;
+}
+
+/* compute the energy of the rows from y_start to y_end - 1
+ * reading through the given window */
+LqrRetVal
+lqr_carver_build_emap_rows(LqrCarver *r, LqrReadingWindow *rwindow, int y_start, int y_end)
+{
+    int y;
+
+    for (y = y_start; y < y_end; y++) {
         LQR_CATCH_CANC(r);
         /* r->nrg_xmin[y] = 0; */
         /* r->nrg_xmax[y] = r->w - 1; */
-        for (x = 0; x < r->w; x++) {
-            LQR_CATCH(lqr_carver_compute_e(r, x, y));
+        LQR_CATCH(lqr_carver_compute_e_row(r, rwindow, y, 0, r->w));
+    }
+
+    return LQR_OK;
+}
+
+/* compute the energy map splitting the rows among the
+ * threads of the pool; each thread gets its own reading
+ * window, and since every point is computed independently
+ * the result is the same as in the serial case */
+LqrRetVal
+lqr_carver_build_emap_threaded(LqrCarver *r)
+{
+    LqrEmapJob job;
+    LqrRetVal ret_val = LQR_OK;
+    int n_threads = r->pool->n_threads;
+    int i;
+
+    LQR_CATCH_MEM(job.rwindows = LQR_CARVER_CALLOC(r, LqrReadingWindow *, n_threads));
+    LQR_CATCH_MEM(job.ret = LQR_CARVER_CALLOC(r, LqrRetVal, n_threads));
+    job.r = r;
+
+    /* the calling thread uses the carver's own window */
+    job.rwindows[0] = r->rwindow;
+    for (i = 1; i < n_threads; i++) {
+        if ((job.rwindows[i] = lqr_carver_rwindow_new(r)) == NULL) {
+            ret_val = LQR_NOMEM;
+            break;
         }
     }
 
-    r->nrg_uptodate = true;
+    if (ret_val == LQR_OK) {
+        lqr_thread_pool_run(r->pool, lqr_carver_build_emap_worker, &job);
+        for (i = 0; i < n_threads; i++) {
+            if (job.ret[i] != LQR_OK) {
+                ret_val = job.ret[i];
+                break;
+            }
+        }
+    }
 
-    return LQR_OK;
+    for (i = 1; i < n_threads; i++) {
+        lqr_rwindow_destroy(job.rwindows[i]);
+    }
+    LRQ_FREE(job.rwindows);
+    LRQ_FREE(job.ret);
+
+    return ret_val;
+}
+
+void
+lqr_carver_build_emap_worker(void *data, int thread_index, int n_threads)
+{
+    LqrEmapJob *job = (LqrEmapJob *) data;
+    LqrCarver *r = job->r;
+    int y_start = r->h * thread_index / n_threads;
+    int y_end = r->h * (thread_index + 1) / n_threads;
+
+    job->ret[thread_index] = lqr_carver_build_emap_rows(r, job->rwindows[thread_index], y_start, y_end);
 }
 
 LqrRetVal
-lqr_carver_compute_e(LqrCarver *r, int x, int y)
+lqr_carver_compute_e(LqrCarver *r, LqrReadingWindow *rwindow, int x, int y)
 {
     int data;
     float b_add = 0;
@@ -603,11 +1141,61 @@ lqr_carver_compute_e(LqrCarver *r, int x, int y)
 
     data = r->raw[y][x];
 
-    LQR_CATCH(lqr_rwindow_fill(r->rwindow, r, x, y));
+    LQR_CATCH(lqr_rwindow_fill(rwindow, r, x, y));
     if (r->bias != NULL) {
         b_add = r->bias[data] / r->w_start;
     }
-    r->en[data] = r->nrg(x, y, r->w, r->h, r->rwindow, r->nrg_extra_data) + b_add;
+    r->en[LQR_MAP_INDEX(r, x, y)] = r->nrg(x, y, r->w, r->h, rwindow, r->nrg_extra_data) + b_add;
+
+    return LQR_OK;
+}
+
+/* compute the energy of the points from x_start to x_end - 1 of row y;
+ * for the builtin gradient energies on a compact layout carver the
+ * cached brightness rows are contiguous, and the inner points are
+ * computed all at once by the gradient row kernel */
+LqrRetVal
+lqr_carver_compute_e_row(LqrCarver *r, LqrReadingWindow *rwindow, int y, int x_start, int x_end)
+{
+    int x, x_first, x_last;
+    LqrGradFuncType gf_type;
+    const double *now;
+    float *en;
+
+    LQR_STATS_COUNT(r, energy_evals, x_end - x_start);
+
+    if (!r->compact || !r->use_rcache || (r->rcache == NULL) || (r->w < 3) || (r->h < 2)
+        || ((r->nrg_read_t != LQR_ER_BRIGHTNESS) && (r->nrg_read_t != LQR_ER_LUMA))
+        || !lqr_energy_builtin_grad_type(r->nrg, &gf_type)) {
+        for (x = x_start; x < x_end; x++) {
+            LQR_CATCH(lqr_carver_compute_e(r, rwindow, x, y));
+        }
+        return LQR_OK;
+    }
+
+    /* the border points are computed one by one */
+    x_first = MAX(x_start, 1);
+    x_last = MIN(x_end, r->w - 1);
+    for (x = x_start; x < MIN(x_first, x_end); x++) {
+        LQR_CATCH(lqr_carver_compute_e(r, rwindow, x, y));
+    }
+    for (x = MAX(x_last, x_first); x < x_end; x++) {
+        LQR_CATCH(lqr_carver_compute_e(r, rwindow, x, y));
+    }
+    if (x_first >= x_last) {
+        return LQR_OK;
+    }
+
+    now = r->rcache + LQR_MAP_ROW(r, y);
+    en = r->en + LQR_MAP_ROW(r, y);
+    r->kernels.grad_row(gf_type, (y > 0 ? r->rcache + LQR_MAP_ROW(r, y - 1) : now), now,
+                        (y < r->h - 1 ? r->rcache + LQR_MAP_ROW(r, y + 1) : now),
+                        ((y > 0) && (y < r->h - 1) ? 0.5 : 1), en, x_first, x_last);
+    if (r->bias != NULL) {
+        for (x = x_first; x < x_last; x++) {
+            en[x] = en[x] + r->bias[r->raw[y][x]] / r->w_start;
+        }
+    }
 
     return LQR_OK;
 }
@@ -624,87 +1212,201 @@ lqr_carver_compute_e(LqrCarver *r, int x, int y)
 LqrRetVal
 lqr_carver_build_mmap(LqrCarver *r)
 {
-    int x, y;
+    int y;
+
+    LQR_CATCH_CANC(r);
+
+    LQR_STATS_TIMER(t0);
+
+    if ((r->pool != NULL) && (r->w >= r->pool->n_threads * LQR_MMAP_MIN_CHUNK)) {
+        LQR_CATCH(lqr_carver_build_mmap_threaded(r));
+    } else {
+        /* span first row */
+        lqr_carver_build_mmap_row(r, 0, 0, r->w);
+
+        /* span all other rows */
+        for (y = 1; y < r->h; y++) {
+            LQR_CATCH_CANC(r);
+            lqr_carver_build_mmap_row(r, y, 0, r->w);
+        }
+    }
+
+    LQR_STATS_PHASE(r, LQR_STATS_BUILD_MMAP, t0);
+    return LQR_OK;
+}
+
+/* compute the minpath map in the columns [x_start, x_end) of row y;
+ * this only reads row y - 1, so that different columns of the same
+ * row can be computed concurrently */
+void
+lqr_carver_build_mmap_row(LqrCarver *r, int y, int x_start, int x_end)
+{
+    int x;
     int data;
     int data_down;
     int x1_min, x1_max, x1;
     float m, m1, r_fact;
 
-    LQR_CATCH_CANC(r);
+    LQR_STATS_COUNT(r, mmap_cells, x_end - x_start);
 
-    /* span first row */
-    for (x = 0; x < r->w; x++) {
-        data = r->raw[0][x];
+    if (r->compact) {
+        lqr_carver_build_mmap_row_compact(r, y, x_start, x_end);
+        return;
+    }
+
+    if (y == 0) {
+        for (x = x_start; x < x_end; x++) {
+            data = r->raw[0][x];
 #ifdef __LQR_DEBUG__
-        assert(r->vs[data] == 0);
+            assert(r->vs[data] == 0);
 #endif /* __LQR_DEBUG__ */
-        r->m[data] = r->en[data];
+            r->m[data] = r->en[data];
+        }
+        return;
     }
 
-    /* span all other rows */
-    for (y = 1; y < r->h; y++) {
-        for (x = 0; x < r->w; x++) {
-            LQR_CATCH_CANC(r);
-
-            data = r->raw[y][x];
+    for (x = x_start; x < x_end; x++) {
+        data = r->raw[y][x];
 #ifdef __LQR_DEBUG__
-            assert(r->vs[data] == 0);
+        assert(r->vs[data] == 0);
 #endif /* __LQR_DEBUG__ */
-            /* watch for boundaries */
-            x1_min = MAX(-x, -r->delta_x);
-            x1_max = MIN(r->w - 1 - x, r->delta_x);
-            if (r->rigidity_mask) {
-                r_fact = r->rigidity_mask[data];
-            } else {
-                r_fact = 1;
-            }
+        /* watch for boundaries */
+        x1_min = MAX(-x, -r->delta_x);
+        x1_max = MIN(r->w - 1 - x, r->delta_x);
+        if (r->rigidity_mask) {
+            r_fact = r->rigidity_mask[data];
+        } else {
+            r_fact = 1;
+        }
 
-            /* we use the data_down pointer to be able to
-             * track the seams later (needed for rigidity) */
-            data_down = r->raw[y - 1][x + x1_min];
-            r->least[data] = data_down;
-            if (r->rigidity) {
-                m = r->m[data_down] + r_fact * r->rigidity_map[x1_min];
-                for (x1 = x1_min + 1; x1 <= x1_max; x1++) {
-                    data_down = r->raw[y - 1][x + x1];
-                    /* find the min among the neighbors
-                     * in the last row */
-                    m1 = r->m[data_down] + r_fact * r->rigidity_map[x1];
-                    if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
-                        m = m1;
-                        r->least[data] = data_down;
-                    }
-                    /* m = MIN(m, r->m[data_down] + r->rigidity_map[x1]); */
+        /* we use the data_down pointer to be able to
+         * track the seams later (needed for rigidity) */
+        data_down = r->raw[y - 1][x + x1_min];
+        r->least[data] = data_down;
+        if (r->rigidity) {
+            m = r->m[data_down] + r_fact * r->rigidity_map[x1_min];
+            for (x1 = x1_min + 1; x1 <= x1_max; x1++) {
+                data_down = r->raw[y - 1][x + x1];
+                /* find the min among the neighbors
+                 * in the last row */
+                m1 = r->m[data_down] + r_fact * r->rigidity_map[x1];
+                if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
+                    m = m1;
+                    r->least[data] = data_down;
                 }
-            } else {
-                m = r->m[data_down];
-                for (x1 = x1_min + 1; x1 <= x1_max; x1++) {
-                    data_down = r->raw[y - 1][x + x1];
-                    /* find the min among the neighbors
-                     * in the last row */
-                    m1 = r->m[data_down];
-                    if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
-                        m = m1;
-                        r->least[data] = data_down;
-                    }
-                    m = MIN(m, r->m[data_down]);
+                /* m = MIN(m, r->m[data_down] + r->rigidity_map[x1]); */
+            }
+        } else {
+            m = r->m[data_down];
+            for (x1 = x1_min + 1; x1 <= x1_max; x1++) {
+                data_down = r->raw[y - 1][x + x1];
+                /* find the min among the neighbors
+                 * in the last row */
+                m1 = r->m[data_down];
+                if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
+                    m = m1;
+                    r->least[data] = data_down;
                 }
+                m = MIN(m, r->m[data_down]);
             }
-
-            /* set current m */
-            r->m[data] = r->en[data] + m;
         }
+
+        /* set current m */
+        r->m[data] = r->en[data] + m;
     }
+}
+
+/* same as lqr_carver_build_mmap_row for the compact layout,
+ * where all the maps are accessed with unit stride and the
+ * computation is left to the (possibly vectorized) minpath kernel */
+void
+lqr_carver_build_mmap_row_compact(LqrCarver *r, int y, int x_start, int x_end)
+{
+    LqrMinpathRow row;
+
+    if (y == 0) {
+        memcpy(r->m + LQR_MAP_ROW(r, 0) + x_start, r->en + LQR_MAP_ROW(r, 0) + x_start,
+               (x_end - x_start) * sizeof(float));
+        return;
+    }
+
+    lqr_carver_minpath_row_setup(r, &row, y, r->m + LQR_MAP_ROW(r, y), r->least_dx + LQR_MAP_ROW(r, y));
+    r->minpath_row(&row, x_start, x_end);
+}
+
+/* prepare the minpath kernel input for row y > 0 of a compact layout
+ * carver; the results will be written in the m and least rows given */
+void
+lqr_carver_minpath_row_setup(LqrCarver *r, LqrMinpathRow *row, int y, float *m, int8_t *least)
+{
+    row->w = r->w;
+    row->delta_x = r->delta_x;
+    row->leftright = r->leftright;
+    row->m_down = r->m + LQR_MAP_ROW(r, y - 1);
+    row->raw = r->raw[y];
+    row->en = r->en + LQR_MAP_ROW(r, y);
+    row->rigidity_map = r->rigidity ? r->rigidity_map : NULL;
+    row->rigidity_mask = r->rigidity_mask;
+    row->m = m;
+    row->least = least;
+}
+
+/* compute the minpath map splitting each row in column
+ * chunks among the threads of the pool; rows are processed
+ * in lockstep, with a barrier between one row and the next */
+LqrRetVal
+lqr_carver_build_mmap_threaded(LqrCarver *r)
+{
+    LqrMmapJob job;
+
+    job.r = r;
+    atomic_init(&job.cancel_row, INT_MAX);
+
+    lqr_thread_pool_run(r->pool, lqr_carver_build_mmap_worker, &job);
+
+    LQR_CATCH_CANC(r);
+
     return LQR_OK;
 }
 
+void
+lqr_carver_build_mmap_worker(void *data, int thread_index, int n_threads)
+{
+    LqrMmapJob *job = (LqrMmapJob *) data;
+    LqrCarver *r = job->r;
+    int x_start = r->w * thread_index / n_threads;
+    int x_end = r->w * (thread_index + 1) / n_threads;
+    int y;
+
+    for (y = 0; y < r->h; y++) {
+        lqr_carver_build_mmap_row(r, y, x_start, x_end);
+
+        /* only the calling thread polls the carver state, once per
+         * row; the decision is published before the barrier so that
+         * all threads agree on where to stop */
+        if ((thread_index == 0) && (atomic_load(&r->state) == LQR_CARVER_STATE_CANCELLED)) {
+            atomic_store(&job->cancel_row, y);
+        }
+
+        lqr_thread_pool_barrier(r->pool);
+
+        if (atomic_load(&job->cancel_row) <= y) {
+            return;
+        }
+    }
+}
+
 /* compute (vertical) visibility map up to given depth
  * (it also calls inflate() to add image enlargment information) */
 LqrRetVal
 lqr_carver_build_vsmap(LqrCarver *r, int depth)
 {
-    int l;
+    int l, s;
+    int n_seams = 1;
     int lr_switch_interval = 0;
+    bool lr_switch;
+    bool guided = false;
+    bool mmap_uptodate = true;
     LqrDataTok data_tok;
 
 #ifdef __LQR_VERBOSE__
@@ -732,33 +1434,67 @@ lqr_carver_build_vsmap(LqrCarver *r, int depth)
         lr_switch_interval = (depth - r->max_level - 1) / r->lr_switch_frequency + 1;
     }
 
-    /* cycle over levels */
-    for (l = r->max_level; l < depth; l++) {
-        LQR_CATCH_CANC(r);
-
-        if ((l - r->max_level + r->session_rescale_current) % r->session_update_step == 0) {
-            lqr_progress_update(r->progress, (double) (l - r->max_level + r->session_rescale_current) /
-                                (double) (r->session_rescale_total));
+    /* multi-resolution search: the seams are guided by those of
+     * a downsampled image, and the minpath map is only computed
+     * (within a band) when needed */
+    LQR_CATCH(lqr_carver_pyramid_init(r, &r->pyramid, depth - r->max_level));
+
+    /* cycle over levels; with more than one seam per pass,
+     * the seams after the first one are computed from the
+     * same minpath map and the maps are updated only at the
+     * end of the pass */
+    for (l = r->max_level; l < depth; l += n_seams) {
+        n_seams = MIN(r->seams_per_pass, depth - l);
+        n_seams = MIN(n_seams, r->w - 1);
+        n_seams = MAX(n_seams, 1);
+        lr_switch = false;
+
+        guided = (r->pyramid.n_seams > 0) && lqr_carver_pyramid_build_vpath(r, &r->pyramid, l - r->max_level);
+        if (guided) {
+            n_seams = 1;
+        } else if (!mmap_uptodate) {
+            LQR_CATCH(lqr_carver_build_mmap(r));
+            mmap_uptodate = true;
         }
+
+        for (s = 0; s < n_seams; s++) {
+            LQR_CATCH_CANC(r);
+
+            if ((l + s - r->max_level + r->session_rescale_current) % r->session_update_step == 0) {
+                lqr_progress_update(r->progress, (double) (l + s - r->max_level + r->session_rescale_current) /
+                                    (double) (r->session_rescale_total));
+            }
 #ifdef __LQR_DEBUG__
-        /* check raw rows */
-        lqr_carver_debug_check_rows(r);
+            /* check raw rows */
+            lqr_carver_debug_check_rows(r);
 #endif /* __LQR_DEBUG__ */
 
-        /* compute vertical seam */
-        lqr_carver_build_vpath(r);
+            /* compute vertical seam */
+            if (guided) {
+                /* already computed */
+            } else if (s == 0) {
+                lqr_carver_build_vpath(r);
+            } else {
+                lqr_carver_build_vpath_approx(r);
+            }
+
+            /* update visibility map
+             * (assign level to the seam) */
+            lqr_carver_update_vsmap(r, l + s + r->max_level - 1);
 
-        /* update visibility map
-         * (assign level to the seam) */
-        lqr_carver_update_vsmap(r, l + r->max_level - 1);
+            /* increase (in)visibility level
+             * (make the last seam invisible) */
+            r->level++;
+            r->w--;
 
-        /* increase (in)visibility level
-         * (make the last seam invisible) */
-        r->level++;
-        r->w--;
+            /* update raw data */
+            lqr_carver_carve(r);
+            lqr_carver_update_carved_range(r, s == 0);
 
-        /* update raw data */
-        lqr_carver_carve(r);
+            if ((r->lr_switch_frequency) && (((l + s - r->max_level + lr_switch_interval / 2) % lr_switch_interval) == 0)) {
+                lr_switch = !lr_switch;
+            }
+        }
 
         if (r->w > 1) {
             /* update the energy */
@@ -766,8 +1502,12 @@ lqr_carver_build_vsmap(LqrCarver *r, int depth)
             LQR_CATCH(lqr_carver_update_emap(r));
 
             /* recalculate the minpath map */
-            if ((r->lr_switch_frequency) && (((l - r->max_level + lr_switch_interval / 2) % lr_switch_interval) == 0)) {
+            if (lr_switch) {
                 r->leftright ^= 1;
+            }
+            if (guided) {
+                mmap_uptodate = false;
+            } else if (lr_switch) {
                 LQR_CATCH(lqr_carver_build_mmap(r));
             } else {
                 /* lqr_carver_build_mmap (r); */
@@ -779,6 +1519,8 @@ lqr_carver_build_vsmap(LqrCarver *r, int depth)
         }
     }
 
+    lqr_carver_pyramid_clear(&r->pyramid);
+
     /* insert seams for image enlargement */
     LQR_CATCH(lqr_carver_inflate(r, depth - 1));
 
@@ -824,6 +1566,8 @@ lqr_carver_inflate(LqrCarver *r, int l)
 
     LQR_CATCH_CANC(r);
 
+    LQR_STATS_TIMER(t0);
+
     if (r->root == NULL) {
         prev_state = atomic_load(&r->state);
         LQR_CATCH(lqr_carver_set_state(r, LQR_CARVER_STATE_INFLATING, true));
@@ -840,20 +1584,35 @@ lqr_carver_inflate(LqrCarver *r, int l)
     /* final width */
     w1 = r->w0 + l - r->max_level + 1;
 
-    /* allocate room for new maps */
-    BUF_TRY_NEW0_RET_LQR(new_rgb, w1 * r->h0 * r->channels, r->col_depth);
+    /* get room for new maps (only the visibility
+     * is not entirely rewritten) */
+    BUF_TRY_RESERVE_RET_LQR(r, new_rgb, r->rgb_spare, w1 * r->h0 * r->channels, r->col_depth);
 
     if (r->root == NULL) {
-        LQR_CATCH_MEM(new_vs = LRQ_CALLOC(int, w1 * r->h0));
+        new_vs = LQR_CARVER_RESERVE0(r, r->vs_spare, int, w1 * r->h0);
+        r->vs_spare = NULL;
     }
     if (r->active) {
         if (r->bias) {
-            LQR_CATCH_MEM(new_bias = LRQ_CALLOC(float, w1 * r->h0));
+            new_bias = LQR_CARVER_RESERVE(r, r->bias_spare, float, w1 * r->h0);
+            r->bias_spare = NULL;
         }
         if (r->rigidity_mask) {
-            LQR_CATCH_MEM(new_rigmask = LRQ_CALLOC(float, w1 * r->h0));
+            new_rigmask = LQR_CARVER_RESERVE(r, r->rigmask_spare, float, w1 * r->h0);
+            r->rigmask_spare = NULL;
         }
     }
+    if (((r->root == NULL) && (new_vs == NULL))
+        || (r->active && r->bias && (new_bias == NULL))
+        || (r->active && r->rigidity_mask && (new_rigmask == NULL))) {
+        lqr_carver_maps_spare(r, new_rgb, new_vs, new_bias, new_rigmask);
+        return LQR_NOMEM;
+    }
+
+    /* the raw rows are rewritten from scratch */
+    if (r->raw != NULL) {
+        lqr_carver_reset_raw_rows(r);
+    }
 
     /* span the image with a cursor
      * and build the new image */
@@ -862,7 +1621,11 @@ lqr_carver_inflate(LqrCarver *r, int l)
     y = 0;
     for (z0 = 0; z0 < w1 * r->h0; z0++, lqr_cursor_next(r->c)) {
 
-        LQR_CATCH_CANC(r);
+        /* check for cancellation once per row */
+        if ((r->c->x == 0) && (atomic_load(&r->state) == LQR_CARVER_STATE_CANCELLED)) {
+            lqr_carver_maps_spare(r, new_rgb, new_vs, new_bias, new_rigmask);
+            return LQR_USRCANCEL;
+        }
 
         /* read visibility */
         vs = r->vs[r->c->now];
@@ -964,40 +1727,32 @@ lqr_carver_inflate(LqrCarver *r, int l)
     }
 #endif /* __LQR_DEBUG__ */
 
-    /* substitute maps */
-    if (!r->preserve_in_buffer) {
-        LRQ_FREE(r->rgb);
-    }
-    /* LRQ_FREE (r->vs); */
-    LRQ_FREE(r->en);
-    LRQ_FREE(r->m);
+    /* substitute maps (the old ones are kept to be reused) */
+    lqr_carver_rgb_replace(r, new_rgb);
     LRQ_FREE(r->rcache);
-    LRQ_FREE(r->least);
-    LRQ_FREE(r->bias);
-    LRQ_FREE(r->rigidity_mask);
+    lqr_carver_maps_spare(r, NULL, NULL, r->bias, r->rigidity_mask);
 
     r->bias = NULL;
+    r->rigidity_mask = NULL;
     r->rcache = NULL;
     r->nrg_uptodate = false;
 
-    r->rgb = new_rgb;
-    r->preserve_in_buffer = false;
-
     if (r->root == NULL) {
-        LRQ_FREE(r->vs);
+        lqr_carver_maps_spare(r, NULL, r->vs, NULL, NULL);
         r->vs = new_vs;
+        r->vs_serial++;
         LQR_CATCH(lqr_carver_propagate_vsmap(r));
     } else {
         /* r->vs = NULL; */
     }
     if (r->nrg_active) {
-        LQR_CATCH_MEM(r->en = LRQ_CALLOC(float, w1 * r->h0));
+        LQR_CATCH_MEM(r->en = LQR_CARVER_RESERVE(r, r->en, float, w1 * r->h0));
     }
     if (r->active) {
         r->bias = new_bias;
         r->rigidity_mask = new_rigmask;
-        LQR_CATCH_MEM(r->m = LRQ_CALLOC(float, w1 * r->h0));
-        LQR_CATCH_MEM(r->least = LRQ_CALLOC(int, w1 * r->h0));
+        LQR_CATCH_MEM(r->m = LQR_CARVER_RESERVE(r, r->m, float, w1 * r->h0));
+        LQR_CATCH(lqr_carver_alloc_least(r, w1 * r->h0));
     }
 
     /* set new widths & levels (w_start is kept for reference) */
@@ -1007,8 +1762,7 @@ lqr_carver_inflate(LqrCarver *r, int l)
     r->w = r->w_start;
 
     /* reset readout buffer */
-    LRQ_FREE(r->rgb_ro_buffer);
-    BUF_TRY_NEW0_RET_LQR(r->rgb_ro_buffer, r->w0 * r->channels, r->col_depth);
+    BUF_TRY_RESERVE_RET_LQR(r, r->rgb_ro_buffer, r->rgb_ro_buffer, r->w0 * r->channels, r->col_depth);
 
 #ifdef __LQR_VERBOSE__
     printf("  [ inflating OK ]\n");
@@ -1019,6 +1773,7 @@ lqr_carver_inflate(LqrCarver *r, int l)
         LQR_CATCH(lqr_carver_set_state(r, prev_state, true));
     }
 
+    LQR_STATS_PHASE(r, LQR_STATS_INFLATE, t0);
     return LQR_OK;
 }
 
@@ -1033,39 +1788,154 @@ lqr_carver_inflate_attached(LqrCarver *r, LqrDataTok data)
 /* do the carving
  * this actually carves the raw array,
  * which holds the indices to be used
- * in all the other maps */
+ * in all the other maps;
+ * rows are shrunk from whichever side of the seam
+ * is shorter: when it's the left side, the points
+ * are shifted to the right and the row pointer is
+ * moved forward, so that each row stays contiguous;
+ * carving is a small share of a resize, so raw is kept
+ * as flat rows rather than a chunked store, which would
+ * slow down the raw[y][x] lookups of the map kernels */
 void
 lqr_carver_carve(LqrCarver *r)
 {
-    int x, y;
+    int y;
+    int x_seam, z0;
+#ifdef __LQR_DEBUG__
+    int x;
+#endif /* __LQR_DEBUG__ */
 
 #ifdef __LQR_DEBUG__
     assert(r->root == NULL);
 #endif /* __LQR_DEBUG__ */
 
+    LQR_STATS_TIMER(t0);
+
     for (y = 0; y < r->h_start; y++) {
+        x_seam = r->vpath_x[y];
 #ifdef __LQR_DEBUG__
-        assert(r->vs[r->raw[y][r->vpath_x[y]]] != 0);
-        for (x = 0; x < r->vpath_x[y]; x++) {
+        assert(r->vs[r->raw[y][x_seam]] != 0);
+        for (x = 0; x < x_seam; x++) {
             assert(r->vs[r->raw[y][x]] == 0);
         }
 #endif /* __LQR_DEBUG__ */
-        for (x = r->vpath_x[y]; x < r->w; x++) {
-            r->raw[y][x] = r->raw[y][x + 1];
+        z0 = LQR_MAP_ROW(r, y);
+        if (x_seam < r->w - x_seam) {
+            memmove(r->raw[y] + 1, r->raw[y], x_seam * sizeof(int));
+            r->raw[y]++;
+            if (r->compact) {
+                lqr_carver_move_maps_compact(r, z0 + 1, z0, x_seam);
+            }
+        } else {
+            memmove(r->raw[y] + x_seam, r->raw[y] + x_seam + 1, (r->w - x_seam) * sizeof(int));
+            if (r->compact) {
+                lqr_carver_move_maps_compact(r, z0 + x_seam, z0 + x_seam + 1, r->w - x_seam);
+            }
+        }
+        if (r->compact && (y > 0)) {
+            lqr_carver_carve_least_dx(r, y);
+        }
 #ifdef __LQR_DEBUG__
+        for (x = 0; x < r->w; x++) {
             assert(r->vs[r->raw[y][x]] == 0);
-#endif /* __LQR_DEBUG__ */
         }
+#endif /* __LQR_DEBUG__ */
     }
 
     r->nrg_uptodate = false;
+    LQR_STATS_PHASE(r, LQR_STATS_CARVE, t0);
+}
+
+/* move n points of the compact layout energy related maps
+ * (physically removes the seam from them while carving) */
+void
+lqr_carver_move_maps_compact(LqrCarver *r, int z_dest, int z_src, int n)
+{
+    int k;
+
+    memmove(r->en + z_dest, r->en + z_src, n * sizeof(float));
+    memmove(r->m + z_dest, r->m + z_src, n * sizeof(float));
+    memmove(r->least_dx + z_dest, r->least_dx + z_src, n * sizeof(int8_t));
+    if (r->rcache != NULL) {
+        k = lqr_carver_rcache_stride(r);
+        memmove(r->rcache + z_dest * k, r->rcache + z_src * k, n * k * sizeof(double));
+    }
+}
+
+/* fix the column offsets of row y which crossed the seam
+ * after carving (only the points close to the seam can be
+ * affected); the offsets pointing to the carved out point
+ * are marked as invalid, so that they'll be recomputed */
+void
+lqr_carver_carve_least_dx(LqrCarver *r, int y)
+{
+    int x, x_min, x_max;
+    int x_seam = r->vpath_x[y];
+    int x_seam_down = r->vpath_x[y - 1];
+    int x_old, x_down;
+    int8_t *least_dx = r->least_dx + LQR_MAP_ROW(r, y);
+
+    x_min = MAX(x_seam - 2 * r->delta_x - 1, 0);
+    x_max = MIN(x_seam + 2 * r->delta_x, r->w - 1);
+    for (x = x_min; x <= x_max; x++) {
+        if (least_dx[x] == LQR_LEAST_DX_NONE) {
+            continue;
+        }
+        /* positions before carving */
+        x_old = (x < x_seam) ? x : x + 1;
+        x_down = x_old + least_dx[x];
+        if (x_down == x_seam_down) {
+            least_dx[x] = LQR_LEAST_DX_NONE;
+        } else {
+            least_dx[x] = (int8_t) ((x_down < x_seam_down ? x_down : x_down - 1) - x);
+        }
+    }
+}
+
+/* keep track of the region affected by the seams carved
+ * since the last energy update (first is true for the
+ * first seam of a pass); the range is given in the
+ * current coordinates, as vpath_x after carving */
+void
+lqr_carver_update_carved_range(LqrCarver *r, bool first)
+{
+    int x, y;
+
+    for (y = 0; y < r->h; y++) {
+        x = r->vpath_x[y];
+        if (first) {
+            r->carved_xmin[y] = x;
+            r->carved_xmax[y] = x;
+        } else {
+            if (r->carved_xmin[y] > x) {
+                r->carved_xmin[y]--;
+            }
+            if (r->carved_xmax[y] > x) {
+                r->carved_xmax[y]--;
+            }
+            r->carved_xmin[y] = MIN(r->carved_xmin[y], x);
+            r->carved_xmax[y] = MAX(r->carved_xmax[y], x);
+        }
+    }
+}
+
+/* bring the raw rows back to the beginning of their storage
+ * (their contents are undefined afterwards) */
+void
+lqr_carver_reset_raw_rows(LqrCarver *r)
+{
+    int y;
+
+    for (y = 0; y < r->h_start; y++) {
+        r->raw[y] = r->_raw + y * r->w_start;
+    }
 }
 
 /* update energy map after seam removal */
 LqrRetVal
 lqr_carver_update_emap(LqrCarver *r)
 {
-    int x, y;
+    int y;
     int y1, y1_min, y1_max;
 
     LQR_CATCH_CANC(r);
@@ -1077,23 +1947,23 @@ lqr_carver_update_emap(LqrCarver *r)
         LQR_CATCH_F(r->rcache != NULL);
     }
 
+    LQR_STATS_TIMER(t0);
+
     for (y = 0; y < r->h; y++) {
         /* note: here the vpath has already
          * been carved */
-        x = r->vpath_x[y];
-        r->nrg_xmin[y] = x;
-        r->nrg_xmax[y] = x - 1;
+        r->nrg_xmin[y] = r->carved_xmin[y];
+        r->nrg_xmax[y] = r->carved_xmax[y] - 1;
     }
     for (y = 0; y < r->h; y++) {
-        x = r->vpath_x[y];
         y1_min = MAX(y - r->nrg_radius, 0);
         y1_max = MIN(y + r->nrg_radius, r->h - 1);
 
         for (y1 = y1_min; y1 <= y1_max; y1++) {
-            r->nrg_xmin[y1] = MIN(r->nrg_xmin[y1], x - r->nrg_radius);
+            r->nrg_xmin[y1] = MIN(r->nrg_xmin[y1], r->carved_xmin[y] - r->nrg_radius);
             r->nrg_xmin[y1] = MAX(0, r->nrg_xmin[y1]);
             /* note: the -1 below is because of the previous carving */
-            r->nrg_xmax[y1] = MAX(r->nrg_xmax[y1], x + r->nrg_radius - 1);
+            r->nrg_xmax[y1] = MAX(r->nrg_xmax[y1], r->carved_xmax[y] + r->nrg_radius - 1);
             r->nrg_xmax[y1] = MIN(r->w - 1, r->nrg_xmax[y1]);
         }
     }
@@ -1101,12 +1971,11 @@ lqr_carver_update_emap(LqrCarver *r)
     for (y = 0; y < r->h; y++) {
         LQR_CATCH_CANC(r);
 
-        for (x = r->nrg_xmin[y]; x <= r->nrg_xmax[y]; x++) {
-            LQR_CATCH(lqr_carver_compute_e(r, x, y));
-        }
+        LQR_CATCH(lqr_carver_compute_e_row(r, r->rwindow, y, r->nrg_xmin[y], r->nrg_xmax[y] + 1));
     }
 
     r->nrg_uptodate = true;
+    LQR_STATS_PHASE(r, LQR_STATS_UPDATE_EMAP, t0);
 
     return LQR_OK;
 }
@@ -1125,17 +1994,36 @@ lqr_carver_update_mmap(LqrCarver *r)
     int x1, dx;
     int x1_min, x1_max;
     int data, data_down, least;
+    int z0;
     float m, m1, r_fact;
     float new_m;
     float *mc = NULL;
+    float *m_cand = NULL;
+    int8_t *least_cand = NULL;
+    LqrMinpathRow row;
     int stop;
     int x_stop;
+    LqrRetVal ret_val = LQR_OK;
 
     LQR_CATCH_CANC(r);
     LQR_CATCH_F(r->nrg_uptodate);
 
+    LQR_STATS_TIMER(t0);
+
+    if (r->rigidity) {
+        mc = LQR_CARVER_CALLOC(r, float, 2 * r->delta_x + 1);
+    }
+    if (r->compact) {
+        m_cand = LQR_CARVER_CALLOC(r, float, r->w);
+        least_cand = LQR_CARVER_CALLOC(r, int8_t, r->w);
+    }
+    if ((r->rigidity && (mc == NULL)) || (r->compact && ((m_cand == NULL) || (least_cand == NULL)))) {
+        LRQ_FREE(mc);
+        LRQ_FREE(m_cand);
+        LRQ_FREE(least_cand);
+        return LQR_NOMEM;
+    }
     if (r->rigidity) {
-        LQR_CATCH_MEM(mc = LRQ_CALLOC(float, 2 * r->delta_x + 1));
         mc += r->delta_x;
     }
 
@@ -1147,13 +2035,16 @@ lqr_carver_update_mmap(LqrCarver *r)
     x_max = MIN(r->nrg_xmax[0], r->w - 1);
 
     for (x = x_min; x <= x_max; x++) {
-        data = r->raw[0][x];
-        r->m[data] = r->en[data];
+        z0 = LQR_MAP_INDEX(r, x, 0);
+        r->m[z0] = r->en[z0];
     }
 
     /* other rows */
     for (y = 1; y < r->h; y++) {
-        LQR_CATCH_CANC(r);
+        if (atomic_load(&r->state) == LQR_CARVER_STATE_CANCELLED) {
+            ret_val = LQR_USRCANCEL;
+            break;
+        }
 
         /* make sure to include the changed energy region */
         x_min = MIN(x_min, r->nrg_xmin[y]);
@@ -1163,85 +2054,103 @@ lqr_carver_update_mmap(LqrCarver *r)
         x_min = MAX(x_min - r->delta_x, 0);
         x_max = MIN(x_max + r->delta_x, r->w - 1);
 
+        LQR_STATS_COUNT(r, mmap_cells, x_max - x_min + 1);
+
+        if (r->compact) {
+            /* compute all the candidate values at once */
+            lqr_carver_minpath_row_setup(r, &row, y, m_cand, least_cand);
+            r->minpath_row(&row, x_min, x_max + 1);
+        }
+
         /* span the affected region */
         stop = 0;
         x_stop = 0;
         for (x = x_min; x <= x_max; x++) {
-            data = r->raw[y][x];
-            if (r->rigidity_mask) {
-                r_fact = r->rigidity_mask[data];
+            z0 = LQR_MAP_INDEX(r, x, y);
+            if (r->compact) {
+                new_m = m_cand[x];
+                least = least_cand[x];
             } else {
-                r_fact = 1;
-            }
+                data = r->raw[y][x];
+                if (r->rigidity_mask) {
+                    r_fact = r->rigidity_mask[data];
+                } else {
+                    r_fact = 1;
+                }
 
-            /* find the minimum in the previous rows
-             * as in build_mmap() */
-            x1_min = MAX(0, x - r->delta_x);
-            x1_max = MIN(r->w - 1, x + r->delta_x);
-
-            if (r->rigidity) {
-                dx = x1_min - x;
-                switch (x1_max - x1_min + 1) {
-                    UPDATE_MMAP_OPTIMISED_CASES_RIG
-                    default:
-                        data_down = r->raw[y - 1][x1_min];
-                        least = data_down;
-                        m = r->m[data_down] + r_fact * r->rigidity_map[dx++];
-                        /* fprintf(stderr, "y,x=%i,%i x1=%i dx=%i mr=%g MR=%g m=%g M=%g\n", y, x, x1_min, dx, m, MRDOWN(y, x1_min, dx), r->m[data_down], MDOWN(y, x1_min)); fflush(stderr);   */
-                        for (x1 = x1_min + 1; x1 <= x1_max; x1++, dx++) {
-                            data_down = r->raw[y - 1][x1];
-                            m1 = r->m[data_down] + r_fact * r->rigidity_map[dx];
-                            /* fprintf(stderr, "y,x=%i,%i x1=%i dx=%i mr=%g MR=%g m=%g M=%g\n", y, x, x1, dx, m1, MRDOWN(y, x1, dx), r->m[data_down], MDOWN(y, x1)); fflush(stderr);   */
-                            if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
-                                m = m1;
-                                least = data_down;
+                /* find the minimum in the previous rows
+                 * as in build_mmap() */
+                x1_min = MAX(0, x - r->delta_x);
+                x1_max = MIN(r->w - 1, x + r->delta_x);
+
+                if (r->rigidity) {
+                    dx = x1_min - x;
+                    switch (x1_max - x1_min + 1) {
+                        UPDATE_MMAP_OPTIMISED_CASES_RIG
+                        default:
+                            data_down = r->raw[y - 1][x1_min];
+                            least = data_down;
+                            m = MDOWN(y, x1_min) + r_fact * r->rigidity_map[dx++];
+                            /* fprintf(stderr, "y,x=%i,%i x1=%i dx=%i mr=%g MR=%g m=%g M=%g\n", y, x, x1_min, dx, m, MRDOWN(y, x1_min, dx), r->m[data_down], MDOWN(y, x1_min)); fflush(stderr);   */
+                            for (x1 = x1_min + 1; x1 <= x1_max; x1++, dx++) {
+                                data_down = r->raw[y - 1][x1];
+                                m1 = MDOWN(y, x1) + r_fact * r->rigidity_map[dx];
+                                /* fprintf(stderr, "y,x=%i,%i x1=%i dx=%i mr=%g MR=%g m=%g M=%g\n", y, x, x1, dx, m1, MRDOWN(y, x1, dx), r->m[data_down], MDOWN(y, x1)); fflush(stderr);   */
+                                if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
+                                    m = m1;
+                                    least = data_down;
+                                }
                             }
-                        }
-                }
-                /* fprintf(stderr, "y,x=%i,%i x1_min,max=%i,%i least=%i m=%g\n", y, x, x1_min, x1_max, least, m); fflush(stderr); */
-            } else {
-                switch (x1_max - x1_min + 1) {
-                    UPDATE_MMAP_OPTIMISED_CASES
-                    default:
-                        data_down = r->raw[y - 1][x1_min];
-                        least = data_down;
-                        m = r->m[data_down];
-                        for (x1 = x1_min + 1; x1 <= x1_max; x1++) {
-                            data_down = r->raw[y - 1][x1];
-                            m1 = r->m[data_down];
-                            if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
-                                m = m1;
-                                least = data_down;
+                    }
+                    /* fprintf(stderr, "y,x=%i,%i x1_min,max=%i,%i least=%i m=%g\n", y, x, x1_min, x1_max, least, m); fflush(stderr); */
+                } else {
+                    switch (x1_max - x1_min + 1) {
+                        UPDATE_MMAP_OPTIMISED_CASES
+                        default:
+                            data_down = r->raw[y - 1][x1_min];
+                            least = data_down;
+                            m = MDOWN(y, x1_min);
+                            for (x1 = x1_min + 1; x1 <= x1_max; x1++) {
+                                data_down = r->raw[y - 1][x1];
+                                m1 = MDOWN(y, x1);
+                                if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
+                                    m = m1;
+                                    least = data_down;
+                                }
                             }
-                        }
+                    }
+                    /* fprintf(stderr, "y,x=%i,%i x1_min,max=%i,%i least=%i m=%g\n", y, x, x1_min, x1_max, least, m); fflush(stderr);   */
                 }
-                /* fprintf(stderr, "y,x=%i,%i x1_min,max=%i,%i least=%i m=%g\n", y, x, x1_min, x1_max, least, m); fflush(stderr);   */
-            }
 
-            new_m = r->en[data] + m;
+                new_m = r->en[z0] + m;
+            }
 
             /* reduce the range if there's no (relevant) difference
              * with the previous map */
-            if (r->least[data] == least) {
-                if (fabsf(r->m[data] - new_m) < UPDATE_TOLERANCE) {
+            if (r->compact ? (r->least_dx[z0] == least) : (r->least[z0] == least)) {
+                if (fabsf(r->m[z0] - new_m) < UPDATE_TOLERANCE) {
                     if (stop == 0) {
                         x_stop = x;
                     }
                     stop = 1;
-                    new_m = r->m[data];
+                    new_m = r->m[z0];
                 } else {
                     stop = 0;
-                    r->m[data] = new_m;
+                    r->m[z0] = new_m;
                 }
                 if ((x == x_min) && stop) {
                     x_min++;
                 }
             } else {
                 stop = 0;
-                r->m[data] = new_m;
+                r->m[z0] = new_m;
             }
 
-            r->least[data] = least;
+            if (r->compact) {
+                r->least_dx[z0] = (int8_t) least;
+            } else {
+                r->least[z0] = least;
+            }
 
             if ((x == x_max) && (stop)) {
                 x_max = x_stop;
@@ -1254,31 +2163,36 @@ lqr_carver_update_mmap(LqrCarver *r)
         mc -= r->delta_x;
         LRQ_FREE(mc);
     }
+    LRQ_FREE(m_cand);
+    LRQ_FREE(least_cand);
 
-    return LQR_OK;
+    LQR_STATS_PHASE(r, LQR_STATS_UPDATE_MMAP, t0);
+    return ret_val;
 }
 
 /* compute seam path from minpath map */
 void
 lqr_carver_build_vpath(LqrCarver *r)
 {
-    int x, y, z0;
+    int x, y;
     float m, m1;
     int last = -1;
     int last_x = 0;
     int x_min, x_max;
 
+    LQR_STATS_TIMER(t0);
+
     /* we start at last row */
     y = r->h - 1;
 
     /* span the last row for the minimum mmap value */
     m = (1 << 29);
-    for (x = 0, z0 = y * r->w_start; x < r->w; x++, z0++) {
+    for (x = 0; x < r->w; x++) {
 #ifdef __LQR_DEBUG__
         assert(r->vs[r->raw[y][x]] == 0);
 #endif /* __LQR_DEBUG__ */
 
-        m1 = r->m[r->raw[y][x]];
+        m1 = r->m[LQR_MAP_INDEX(r, x, y)];
         if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
             last = r->raw[y][x];
             last_x = x;
@@ -1298,8 +2212,12 @@ lqr_carver_build_vpath(LqrCarver *r)
 #endif /* __LQR_DEBUG__ */
         r->vpath[y] = last;
         r->vpath_x[y] = last_x;
-        if (y > 0) {
-            last = r->least[r->raw[y][last_x]];
+        if (y > 0 && r->compact) {
+            /* the x coordinate is stored directly */
+            last_x += r->least_dx[LQR_MAP_INDEX(r, last_x, y)];
+            last = r->raw[y - 1][last_x];
+        } else if (y > 0) {
+            last = r->least[LQR_MAP_INDEX(r, last_x, y)];
             /* we also need to retrieve the x coordinate */
             x_min = MAX(last_x - r->delta_x, 0);
             x_max = MIN(last_x + r->delta_x, r->w - 1);
@@ -1315,6 +2233,8 @@ lqr_carver_build_vpath(LqrCarver *r)
         }
     }
 
+    LQR_STATS_PHASE(r, LQR_STATS_BUILD_VPATH, t0);
+
 #if 0
     /* we backtrack the seam following the min mmap */
     for (y = r->h0 - 1; y >= 0; y--) {
@@ -1342,6 +2262,60 @@ lqr_carver_build_vpath(LqrCarver *r)
 #endif
 }
 
+/* compute seam path from a minpath map which was not updated
+ * after the previous seams were carved: the predecessors are
+ * chosen again among the visible points, as the stored ones
+ * may have been carved out */
+void
+lqr_carver_build_vpath_approx(LqrCarver *r)
+{
+    int x, y;
+    int x1, x_min, x_max;
+    int last_x = 0;
+    float m, m1;
+    float r_fact = 1;
+
+    LQR_STATS_TIMER(t0);
+
+    /* span the last row for the minimum mmap value */
+    y = r->h - 1;
+    m = (1 << 29);
+    for (x = 0; x < r->w; x++) {
+        m1 = r->m[LQR_MAP_INDEX(r, x, y)];
+        if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
+            last_x = x;
+            m = m1;
+        }
+    }
+
+    /* backtrack following the min mmap */
+    for (y = r->h - 1; y >= 0; y--) {
+        x = last_x;
+        r->vpath[y] = r->raw[y][x];
+        r->vpath_x[y] = x;
+        if (y > 0) {
+            if (r->rigidity_mask) {
+                r_fact = r->rigidity_mask[r->vpath[y]];
+            }
+            x_min = MAX(x - r->delta_x, 0);
+            x_max = MIN(x + r->delta_x, r->w - 1);
+            m = (1 << 29);
+            for (x1 = x_min; x1 <= x_max; x1++) {
+                m1 = r->m[LQR_MAP_INDEX(r, x1, y - 1)];
+                if (r->rigidity) {
+                    m1 += r_fact * r->rigidity_map[x1 - x];
+                }
+                if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
+                    last_x = x1;
+                    m = m1;
+                }
+            }
+        }
+    }
+
+    LQR_STATS_PHASE(r, LQR_STATS_BUILD_VPATH, t0);
+}
+
 /* update visibility map after seam computation */
 void
 lqr_carver_update_vsmap(LqrCarver *r, int l)
@@ -1357,6 +2331,7 @@ lqr_carver_update_vsmap(LqrCarver *r, int l)
 #endif /* __LQR_DEBUG__ */
         r->vs[r->vpath[y]] = l;
     }
+    r->vs_serial++;
 }
 
 /* complete visibility map (last seam) */
@@ -1435,8 +2410,9 @@ lqr_carver_flatten(LqrCarver *r)
     void *new_rgb = NULL;
     float *new_bias = NULL;
     float *new_rigmask = NULL;
-    int x, y, k;
-    int z0;
+    int x, y, u, end, n;
+    int z0, z1;
+    size_t pxl_size;
     LqrDataTok data_tok;
     LqrCarverState prev_state = LQR_CARVER_STATE_STD;
 
@@ -1447,6 +2423,8 @@ lqr_carver_flatten(LqrCarver *r)
 
     LQR_CATCH_CANC(r);
 
+    LQR_STATS_TIMER(t0);
+
     if (r->root == NULL) {
         prev_state = atomic_load(&r->state);
         LQR_CATCH(lqr_carver_set_state(r, LQR_CARVER_STATE_FLATTENING, true));
@@ -1456,89 +2434,93 @@ lqr_carver_flatten(LqrCarver *r)
     data_tok.data = NULL;
     LQR_CATCH(lqr_carver_list_foreach(r->attached_list, lqr_carver_flatten_attached, data_tok));
 
-    /* free non needed maps first */
-    LRQ_FREE(r->en);
-    LRQ_FREE(r->m);
+    /* free non needed maps first (the others are
+     * kept to be reused) */
     LRQ_FREE(r->rcache);
-    LRQ_FREE(r->least);
 
     r->rcache = NULL;
     r->nrg_uptodate = false;
 
-    /* allocate room for new map */
-    BUF_TRY_NEW0_RET_LQR(new_rgb, r->w * r->h * r->channels, r->col_depth);
+    /* get room for the new maps (they are fully rewritten) */
+    BUF_TRY_RESERVE_RET_LQR(r, new_rgb, r->rgb_spare, r->w * r->h * r->channels, r->col_depth);
 
-    if (r->active) {
-        if (r->rigidity_mask) {
-            LQR_CATCH_MEM(new_rigmask = LRQ_CALLOC(float, r->w * r->h));
-        }
+    if (r->active && r->rigidity_mask) {
+        new_rigmask = LQR_CARVER_RESERVE(r, r->rigmask_spare, float, r->w * r->h);
+        r->rigmask_spare = NULL;
+    }
+    if (r->nrg_active && r->bias) {
+        new_bias = LQR_CARVER_RESERVE(r, r->bias_spare, float, r->w * r->h);
+        r->bias_spare = NULL;
+    }
+    if ((r->active && r->rigidity_mask && (new_rigmask == NULL))
+        || (r->nrg_active && r->bias && (new_bias == NULL))) {
+        lqr_carver_maps_spare(r, new_rgb, NULL, new_bias, new_rigmask);
+        return LQR_NOMEM;
     }
     if (r->nrg_active) {
-        if (r->bias) {
-            LQR_CATCH_MEM(new_bias = LRQ_CALLOC(float, r->w * r->h));
+        r->_raw = LQR_CARVER_RESERVE(r, r->_raw, int, r->w * r->h);
+        r->raw = LQR_CARVER_RESERVE(r, r->raw, int *, r->h);
+        if ((r->_raw == NULL) || (r->raw == NULL)) {
+            lqr_carver_maps_spare(r, new_rgb, NULL, new_bias, new_rigmask);
+            return LQR_NOMEM;
         }
-        LRQ_FREE(r->_raw);
-        LRQ_FREE(r->raw);
-        LQR_CATCH_MEM(r->_raw = LRQ_CALLOC(int, r->w * r->h));
-        LQR_CATCH_MEM(r->raw = LRQ_CALLOC(int *, r->h));
     }
 
-    /* span the image with the cursor and copy
-     * it in the new array  */
+    /* span the image with the cursor and copy it in the new
+     * array, one run of consecutive visible points at a time */
     lqr_cursor_reset(r->c);
+    pxl_size = (size_t) r->channels * PXL_SIZE(r->col_depth);
     for (y = 0; y < r->h; y++) {
-        LQR_CATCH_CANC(r);
-
-        if (r->nrg_active) {
-            r->raw[y] = r->_raw + y * r->w;
+        if (atomic_load(&r->state) == LQR_CARVER_STATE_CANCELLED) {
+            lqr_carver_maps_spare(r, new_rgb, NULL, new_bias, new_rigmask);
+            return LQR_USRCANCEL;
         }
-        for (x = 0; x < r->w; x++) {
+
+        for (x = 0, u = 0; x < r->w; x += n, u = end) {
+            u = lqr_cursor_vis_run(r->c, y, u, &end);
+            n = end - u;
             z0 = y * r->w + x;
-            for (k = 0; k < r->channels; k++) {
-                PXL_COPY(new_rgb, z0 * r->channels + k, r->rgb, r->c->now * r->channels + k, r->col_depth);
+            z1 = y * r->w0 + u;
+            memcpy((unsigned char *) new_rgb + (size_t) z0 * pxl_size, (unsigned char *) r->rgb + (size_t) z1 * pxl_size,
+                   n * pxl_size);
+            if (r->active && r->rigidity_mask) {
+                memcpy(new_rigmask + z0, r->rigidity_mask + z1, n * sizeof(float));
             }
-            if (r->active) {
-                if (r->rigidity_mask) {
-                    new_rigmask[z0] = r->rigidity_mask[r->c->now];
-                }
+            if (r->nrg_active && r->bias) {
+                memcpy(new_bias + z0, r->bias + z1, n * sizeof(float));
             }
-            if (r->nrg_active) {
-                if (r->bias) {
-                    new_bias[z0] = r->bias[r->c->now];
-                }
-                r->raw[y][x] = z0;
+        }
+        if (r->nrg_active) {
+            r->raw[y] = r->_raw + y * r->w;
+            for (x = 0; x < r->w; x++) {
+                r->raw[y][x] = y * r->w + x;
             }
-            lqr_cursor_next(r->c);
         }
     }
 
     /* substitute the old maps */
-    if (!r->preserve_in_buffer) {
-        LRQ_FREE(r->rgb);
-    }
-    r->rgb = new_rgb;
-    r->preserve_in_buffer = false;
+    lqr_carver_rgb_replace(r, new_rgb);
     if (r->nrg_active) {
-        LRQ_FREE(r->bias);
+        lqr_carver_maps_spare(r, NULL, NULL, r->bias, NULL);
         r->bias = new_bias;
     }
     if (r->active) {
-        LRQ_FREE(r->rigidity_mask);
+        lqr_carver_maps_spare(r, NULL, NULL, NULL, r->rigidity_mask);
         r->rigidity_mask = new_rigmask;
     }
 
     /* init the other maps */
     if (r->root == NULL) {
-        LRQ_FREE(r->vs);
-        LQR_CATCH_MEM(r->vs = LRQ_CALLOC(int, r->w * r->h));
+        LQR_CATCH_MEM(r->vs = LQR_CARVER_RESERVE0(r, r->vs, int, r->w * r->h));
+        r->vs_serial++;
         LQR_CATCH(lqr_carver_propagate_vsmap(r));
     }
     if (r->nrg_active) {
-        LQR_CATCH_MEM(r->en = LRQ_CALLOC(float, r->w * r->h));
+        LQR_CATCH_MEM(r->en = LQR_CARVER_RESERVE(r, r->en, float, r->w * r->h));
     }
     if (r->active) {
-        LQR_CATCH_MEM(r->m = LRQ_CALLOC(float, r->w * r->h));
-        LQR_CATCH_MEM(r->least = LRQ_CALLOC(int, r->w * r->h));
+        LQR_CATCH_MEM(r->m = LQR_CARVER_RESERVE(r, r->m, float, r->w * r->h));
+        LQR_CATCH(lqr_carver_alloc_least(r, r->w * r->h));
     }
 
     /* reset widths, heights & levels */
@@ -1558,6 +2540,7 @@ lqr_carver_flatten(LqrCarver *r)
         LQR_CATCH(lqr_carver_set_state(r, prev_state, true));
     }
 
+    LQR_STATS_PHASE(r, LQR_STATS_FLATTEN, t0);
     return LQR_OK;
 }
 
@@ -1568,13 +2551,16 @@ lqr_carver_flatten_attached(LqrCarver *r, LqrDataTok data)
 }
 
 /* transpose the image, in its current state
- * (all maps and invisible points are lost) */
+ * (all maps and invisible points are lost);
+ * this also flattens the image, in the same pass */
 LqrRetVal
 lqr_carver_transpose(LqrCarver *r)
 {
-    int x, y, k;
-    int z0, z1;
-    int d;
+    int x, y, u, end;
+    int x0, x1, y0, y1;
+    int w, h;
+    size_t pxl_size;
+    int *idx = NULL;
     void *new_rgb = NULL;
     float *new_bias = NULL;
     float *new_rigmask = NULL;
@@ -1588,108 +2574,139 @@ lqr_carver_transpose(LqrCarver *r)
 
     LQR_CATCH_CANC(r);
 
+    LQR_STATS_TIMER(t0);
+
     if (r->root == NULL) {
         prev_state = atomic_load(&r->state);
         LQR_CATCH(lqr_carver_set_state(r, LQR_CARVER_STATE_TRANSPOSING, true));
     }
 
-    if (r->level > 1) {
-        LQR_CATCH(lqr_carver_flatten(r));
-    }
-
     /* first iterate on attached carvers */
     data_tok.data = NULL;
     LQR_CATCH(lqr_carver_list_foreach(r->attached_list, lqr_carver_transpose_attached, data_tok));
 
-    /* free non needed maps first */
-    if (r->root == NULL) {
-        LRQ_FREE(r->vs);
-    }
-    LRQ_FREE(r->en);
-    LRQ_FREE(r->m);
+    /* free non needed maps first (the others are
+     * kept to be reused) */
     LRQ_FREE(r->rcache);
-    LRQ_FREE(r->least);
-    LRQ_FREE(r->rgb_ro_buffer);
 
     r->rcache = NULL;
     r->nrg_uptodate = false;
 
-    /* allocate room for the new maps */
-    BUF_TRY_NEW0_RET_LQR(new_rgb, r->w0 * r->h0 * r->channels, r->col_depth);
+    /* only the visible part of the image is kept */
+    w = r->w;
+    h = r->h;
 
-    if (r->active) {
-        if (r->rigidity_mask) {
-            LQR_CATCH_MEM(new_rigmask = LRQ_CALLOC(float, r->w0 * r->h0));
-        }
+    /* get room for the new maps (they are fully rewritten) */
+    BUF_TRY_RESERVE_RET_LQR(r, new_rgb, r->rgb_spare, w * h * r->channels, r->col_depth);
+
+    if (r->active && r->rigidity_mask) {
+        new_rigmask = LQR_CARVER_RESERVE(r, r->rigmask_spare, float, w * h);
+        r->rigmask_spare = NULL;
+    }
+    if (r->nrg_active && r->bias) {
+        new_bias = LQR_CARVER_RESERVE(r, r->bias_spare, float, w * h);
+        r->bias_spare = NULL;
+    }
+    if ((r->active && r->rigidity_mask && (new_rigmask == NULL))
+        || (r->nrg_active && r->bias && (new_bias == NULL))) {
+        lqr_carver_maps_spare(r, new_rgb, NULL, new_bias, new_rigmask);
+        return LQR_NOMEM;
     }
     if (r->nrg_active) {
-        if (r->bias) {
-            LQR_CATCH_MEM(new_bias = LRQ_CALLOC(float, r->w0 * r->h0));
+        r->_raw = LQR_CARVER_RESERVE(r, r->_raw, int, w * h);
+        r->raw = LQR_CARVER_RESERVE(r, r->raw, int *, w);
+        if ((r->_raw == NULL) || (r->raw == NULL)) {
+            lqr_carver_maps_spare(r, new_rgb, NULL, new_bias, new_rigmask);
+            return LQR_NOMEM;
         }
-        LRQ_FREE(r->_raw);
-        LRQ_FREE(r->raw);
-        LQR_CATCH_MEM(r->_raw = LRQ_CALLOC(int, r->h0 * r->w0));
-        LQR_CATCH_MEM(r->raw = LRQ_CALLOC(int *, r->w0));
     }
 
-    /* compute trasposed maps */
-    for (x = 0; x < r->w; x++) {
-        if (r->nrg_active) {
-            r->raw[x] = r->_raw + x * r->h0;
+    /* if there are invisible points, the indices of the visible
+     * ones are collected with the cursor (one run of consecutive
+     * points at a time), one strip of rows at a time */
+    if (r->level > 1) {
+        idx = LQR_CARVER_RESERVE(r, NULL, int, LQR_TRANSPOSE_TILE * w);
+        if (idx == NULL) {
+            lqr_carver_maps_spare(r, new_rgb, NULL, new_bias, new_rigmask);
+            return LQR_NOMEM;
         }
-        for (y = 0; y < r->h; y++) {
-            z0 = y * r->w0 + x;
-            z1 = x * r->h0 + y;
-            for (k = 0; k < r->channels; k++) {
-                PXL_COPY(new_rgb, z1 * r->channels + k, r->rgb, z0 * r->channels + k, r->col_depth);
-            }
-            if (r->active) {
-                if (r->rigidity_mask) {
-                    new_rigmask[z1] = r->rigidity_mask[z0];
+        lqr_cursor_reset(r->c);
+    }
+
+    /* compute trasposed maps, one strip of tiles at a time
+     * (the strips are rows of the old maps and columns of the new ones) */
+    pxl_size = (size_t) r->channels * PXL_SIZE(r->col_depth);
+    for (y0 = 0; y0 < h; y0 += LQR_TRANSPOSE_TILE) {
+        if (atomic_load(&r->state) == LQR_CARVER_STATE_CANCELLED) {
+            LRQ_FREE(idx);
+            lqr_carver_maps_spare(r, new_rgb, NULL, new_bias, new_rigmask);
+            return LQR_USRCANCEL;
+        }
+
+        y1 = MIN(y0 + LQR_TRANSPOSE_TILE, h);
+        if (idx) {
+            for (y = y0; y < y1; y++) {
+                for (x = 0, u = 0; x < w; u = end) {
+                    u = lqr_cursor_vis_run(r->c, y, u, &end);
+                    for (; u < end; u++) {
+                        idx[(y - y0) * w + x++] = y * r->w0 + u;
+                    }
                 }
             }
-            if (r->nrg_active) {
-                if (r->bias) {
-                    new_bias[z1] = r->bias[z0];
-                }
-                r->raw[x][y] = z1;
+        }
+        for (x0 = 0; x0 < w; x0 += LQR_TRANSPOSE_TILE) {
+            x1 = MIN(x0 + LQR_TRANSPOSE_TILE, w);
+            lqr_carver_transpose_tile(new_rgb, r->rgb, idx, w, h, x0, x1, y0, y1, pxl_size);
+            if (new_rigmask) {
+                TRANSPOSE_TILE(new_rigmask, r->rigidity_mask, idx, w, h, x0, x1, y0, y1, sizeof(float));
+            }
+            if (new_bias) {
+                TRANSPOSE_TILE(new_bias, r->bias, idx, w, h, x0, x1, y0, y1, sizeof(float));
             }
         }
     }
+    LRQ_FREE(idx);
 
-    /* substitute the map */
-    if (!r->preserve_in_buffer) {
-        LRQ_FREE(r->rgb);
+    /* the transposed maps are not carved, so the raw rows are
+     * just consecutive */
+    if (r->nrg_active) {
+        for (x = 0; x < w; x++) {
+            r->raw[x] = r->_raw + x * h;
+            for (y = 0; y < h; y++) {
+                r->raw[x][y] = x * h + y;
+            }
+        }
     }
-    r->rgb = new_rgb;
-    r->preserve_in_buffer = false;
+
+    /* substitute the map */
+    lqr_carver_rgb_replace(r, new_rgb);
 
     if (r->nrg_active) {
-        LRQ_FREE(r->bias);
+        lqr_carver_maps_spare(r, NULL, NULL, r->bias, NULL);
         r->bias = new_bias;
     }
     if (r->active) {
-        LRQ_FREE(r->rigidity_mask);
+        lqr_carver_maps_spare(r, NULL, NULL, NULL, r->rigidity_mask);
         r->rigidity_mask = new_rigmask;
     }
 
     /* init the other maps */
     if (r->root == NULL) {
-        LQR_CATCH_MEM(r->vs = LRQ_CALLOC(int, r->w0 * r->h0));
+        LQR_CATCH_MEM(r->vs = LQR_CARVER_RESERVE0(r, r->vs, int, w * h));
+        r->vs_serial++;
         LQR_CATCH(lqr_carver_propagate_vsmap(r));
     }
     if (r->nrg_active) {
-        LQR_CATCH_MEM(r->en = LRQ_CALLOC(float, r->w0 * r->h0));
+        LQR_CATCH_MEM(r->en = LQR_CARVER_RESERVE(r, r->en, float, w * h));
     }
     if (r->active) {
-        LQR_CATCH_MEM(r->m = LRQ_CALLOC(float, r->w0 * r->h0));
-        LQR_CATCH_MEM(r->least = LRQ_CALLOC(int, r->w0 * r->h0));
+        LQR_CATCH_MEM(r->m = LQR_CARVER_RESERVE(r, r->m, float, w * h));
+        LQR_CATCH(lqr_carver_alloc_least(r, w * h));
     }
 
     /* switch widths & heights */
-    d = r->w0;
-    r->w0 = r->h0;
-    r->h0 = d;
+    r->w0 = h;
+    r->h0 = w;
     r->w = r->w0;
     r->h = r->h0;
 
@@ -1701,17 +2718,15 @@ lqr_carver_transpose(LqrCarver *r)
 
     /* reset seam path, cursor and readout buffer */
     if (r->active) {
-        LRQ_FREE(r->vpath);
-        LQR_CATCH_MEM(r->vpath = LRQ_CALLOC(int, r->h));
-        LRQ_FREE(r->vpath_x);
-        LQR_CATCH_MEM(r->vpath_x = LRQ_CALLOC(int, r->h));
-        LRQ_FREE(r->nrg_xmin);
-        LQR_CATCH_MEM(r->nrg_xmin = LRQ_CALLOC(int, r->h));
-        LRQ_FREE(r->nrg_xmax);
-        LQR_CATCH_MEM(r->nrg_xmax = LRQ_CALLOC(int, r->h));
+        LQR_CATCH_MEM(r->vpath = LQR_CARVER_RESERVE0(r, r->vpath, int, r->h));
+        LQR_CATCH_MEM(r->vpath_x = LQR_CARVER_RESERVE0(r, r->vpath_x, int, r->h));
+        LQR_CATCH_MEM(r->nrg_xmin = LQR_CARVER_RESERVE0(r, r->nrg_xmin, int, r->h));
+        LQR_CATCH_MEM(r->nrg_xmax = LQR_CARVER_RESERVE0(r, r->nrg_xmax, int, r->h));
+        LQR_CATCH_MEM(r->carved_xmin = LQR_CARVER_RESERVE0(r, r->carved_xmin, int, r->h));
+        LQR_CATCH_MEM(r->carved_xmax = LQR_CARVER_RESERVE0(r, r->carved_xmax, int, r->h));
     }
 
-    BUF_TRY_NEW0_RET_LQR(r->rgb_ro_buffer, r->w0 * r->channels, r->col_depth);
+    BUF_TRY_RESERVE_RET_LQR(r, r->rgb_ro_buffer, r->rgb_ro_buffer, r->w0 * r->channels, r->col_depth);
 
     /* rescale rigidity */
 
@@ -1733,9 +2748,54 @@ lqr_carver_transpose(LqrCarver *r)
         LQR_CATCH(lqr_carver_set_state(r, prev_state, true));
     }
 
+    LQR_STATS_PHASE(r, LQR_STATS_TRANSPOSE, t0);
     return LQR_OK;
 }
 
+/* transpose one tile of a map (see TRANSPOSE_TILE): the most common
+ * pixel sizes get their own loop, so that each pixel is moved with a
+ * few plain loads and stores rather than through a call to memcpy */
+void
+lqr_carver_transpose_tile(void *dest, const void *src, const int *idx, int src_w, int dest_w, int x_min, int x_max,
+                          int y_min, int y_max, size_t pxl_size)
+{
+    switch (pxl_size) {
+        case 1:
+            TRANSPOSE_TILE(dest, src, idx, src_w, dest_w, x_min, x_max, y_min, y_max, 1);
+            break;
+        case 2:
+            TRANSPOSE_TILE(dest, src, idx, src_w, dest_w, x_min, x_max, y_min, y_max, 2);
+            break;
+        case 3:
+            TRANSPOSE_TILE(dest, src, idx, src_w, dest_w, x_min, x_max, y_min, y_max, 3);
+            break;
+        case 4:
+            TRANSPOSE_TILE(dest, src, idx, src_w, dest_w, x_min, x_max, y_min, y_max, 4);
+            break;
+        case 6:
+            TRANSPOSE_TILE(dest, src, idx, src_w, dest_w, x_min, x_max, y_min, y_max, 6);
+            break;
+        case 8:
+            TRANSPOSE_TILE(dest, src, idx, src_w, dest_w, x_min, x_max, y_min, y_max, 8);
+            break;
+        case 12:
+            TRANSPOSE_TILE(dest, src, idx, src_w, dest_w, x_min, x_max, y_min, y_max, 12);
+            break;
+        case 16:
+            TRANSPOSE_TILE(dest, src, idx, src_w, dest_w, x_min, x_max, y_min, y_max, 16);
+            break;
+        case 24:
+            TRANSPOSE_TILE(dest, src, idx, src_w, dest_w, x_min, x_max, y_min, y_max, 24);
+            break;
+        case 32:
+            TRANSPOSE_TILE(dest, src, idx, src_w, dest_w, x_min, x_max, y_min, y_max, 32);
+            break;
+        default:
+            TRANSPOSE_TILE(dest, src, idx, src_w, dest_w, x_min, x_max, y_min, y_max, pxl_size);
+            break;
+    }
+}
+
 LqrRetVal
 lqr_carver_transpose_attached(LqrCarver *r, LqrDataTok data)
 {
@@ -1914,6 +2974,24 @@ lqr_carver_resize(LqrCarver *r, int w1, int h1)
     LQR_CATCH_CANC(r);
     LQR_CATCH_F(atomic_load(&r->state) == LQR_CARVER_STATE_STD);
 
+    if (r->dual.enabled) {
+        LQR_CATCH(lqr_carver_dual_resize(r, w1, h1));
+    } else {
+        LQR_CATCH(lqr_carver_resize_ordered(r, w1, h1));
+    }
+    lqr_carver_scan_reset_all(r);
+
+#ifdef __LQR_VERBOSE__
+    printf("[ Rescale OK ]\n");
+    fflush(stdout);
+#endif /* __LQR_VERBOSE__ */
+    return LQR_OK;
+}
+
+/* resize along both axes, in the order set by the resize order */
+LqrRetVal
+lqr_carver_resize_ordered(LqrCarver *r, int w1, int h1)
+{
     switch (r->resize_order) {
         case LQR_RES_ORDER_HOR:
             LQR_CATCH(lqr_carver_resize_width(r, w1));
@@ -1928,42 +3006,36 @@ lqr_carver_resize(LqrCarver *r, int w1, int h1)
             assert(0);
 #endif /* __LQR_DEBUG__ */
     }
-    lqr_carver_scan_reset_all(r);
-
-#ifdef __LQR_VERBOSE__
-    printf("[ Rescale OK ]\n");
-    fflush(stdout);
-#endif /* __LQR_VERBOSE__ */
     return LQR_OK;
 }
 
+/* state transitions (of the root carver and of the attached ones)
+ * are serialized by the state lock, which is only held for the
+ * duration of the transition itself; the state is read without
+ * locking (e.g. by the cancellation checks) */
 LqrRetVal
 lqr_carver_set_state(LqrCarver *r, LqrCarverState state, bool skip_canceled)
 {
     LqrDataTok data_tok;
-    int lock_pos;
+    LqrRetVal ret_val;
 
     LQR_CATCH_F(r->root == NULL);
 
-    lock_pos = atomic_fetch_add(&r->state_lock_queue, 1);
-
-    while (atomic_load(&r->state_lock) != lock_pos) {
-        sleep(10);
-    }
+    pthread_mutex_lock(&r->state_lock);
 
     if (skip_canceled && atomic_load(&r->state) == LQR_CARVER_STATE_CANCELLED) {
-        atomic_fetch_add(&r->state_lock, 1);
+        pthread_mutex_unlock(&r->state_lock);
         return LQR_OK;
     }
 
     atomic_store(&r->state, state);
 
     data_tok.integer = state;
-    LQR_CATCH(lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_set_state_attached, data_tok));
+    ret_val = lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_set_state_attached, data_tok);
 
-    atomic_fetch_add(&r->state_lock, 1);
+    pthread_mutex_unlock(&r->state_lock);
 
-    return LQR_OK;
+    return ret_val;
 }
 
 LqrRetVal
@@ -2077,6 +3149,22 @@ lqr_carver_get_depth(LqrCarver *r)
     return r->w0 - r->w_start;
 }
 
+/* get number of threads */
+/* LQR_PUBLIC */
+int
+lqr_carver_get_n_threads(LqrCarver *r)
+{
+    return r->n_threads;
+}
+
+/* get number of seams per pass */
+/* LQR_PUBLIC */
+int
+lqr_carver_get_seams_per_pass(LqrCarver *r)
+{
+    return r->seams_per_pass;
+}
+
 /* readout reset */
 /* LQR_PUBLIC */
 void
@@ -2106,7 +3194,6 @@ lqr_carver_scan_reset_all(LqrCarver *r)
 bool
 lqr_carver_scan(LqrCarver *r, int *x, int *y, uint8_t **rgb)
 {
-    int k;
     if (r->col_depth != LQR_COLDEPTH_8I) {
         return false;
     }
@@ -2114,13 +3201,13 @@ lqr_carver_scan(LqrCarver *r, int *x, int *y, uint8_t **rgb)
         lqr_carver_scan_reset(r);
         return false;
     }
+    LQR_STATS_TIMER(t0);
     (*x) = (r->transposed ? r->c->y : r->c->x);
     (*y) = (r->transposed ? r->c->x : r->c->y);
-    for (k = 0; k < r->channels; k++) {
-        AS_8I(r->rgb_ro_buffer)[k] = AS_8I(r->rgb)[r->c->now * r->channels + k];
-    }
+    memcpy(r->rgb_ro_buffer, AS_8I(r->rgb) + (size_t) r->c->now * r->channels, r->channels);
     (*rgb) = AS_8I(r->rgb_ro_buffer);
     lqr_cursor_next(r->c);
+    LQR_STATS_PHASE(r, LQR_STATS_READOUT, t0);
     return true;
 }
 
@@ -2128,20 +3215,21 @@ lqr_carver_scan(LqrCarver *r, int *x, int *y, uint8_t **rgb)
 bool
 lqr_carver_scan_ext(LqrCarver *r, int *x, int *y, void **rgb)
 {
-    int k;
+    size_t pxl_size = PXL_SIZE(r->col_depth) * r->channels;
+
     if (r->c->eoc) {
         lqr_carver_scan_reset(r);
         return false;
     }
+    LQR_STATS_TIMER(t0);
     (*x) = (r->transposed ? r->c->y : r->c->x);
     (*y) = (r->transposed ? r->c->x : r->c->y);
-    for (k = 0; k < r->channels; k++) {
-        PXL_COPY(r->rgb_ro_buffer, k, r->rgb, r->c->now * r->channels + k, r->col_depth);
-    }
+    memcpy(r->rgb_ro_buffer, (char *) r->rgb + (size_t) r->c->now * pxl_size, pxl_size);
 
     BUF_POINTER_COPY(rgb, r->rgb_ro_buffer, r->col_depth);
 
     lqr_cursor_next(r->c);
+    LQR_STATS_PHASE(r, LQR_STATS_READOUT, t0);
     return true;
 }
 
@@ -2167,27 +3255,373 @@ lqr_carver_scan_line(LqrCarver *r, int *n, uint8_t **rgb)
 bool
 lqr_carver_scan_line_ext(LqrCarver *r, int *n, void **rgb)
 {
-    int k, x;
     if (r->c->eoc) {
         lqr_carver_scan_reset(r);
         return false;
     }
-    x = r->c->x;
+    LQR_STATS_TIMER(t0);
+    /* the whole line is read, also if it was partly scanned */
     (*n) = r->c->y;
-    while (x > 0) {
-        lqr_cursor_prev(r->c);
-        x = r->c->x;
+    lqr_carver_copy_line(r, r->c, r->c->y, r->w, r->rgb_ro_buffer);
+    lqr_cursor_next_line(r->c);
+
+    BUF_POINTER_COPY(rgb, r->rgb_ro_buffer, r->col_depth);
+
+    LQR_STATS_PHASE(r, LQR_STATS_READOUT, t0);
+    return true;
+}
+
+/* copy the width visible points of line y, as seen by the cursor c,
+ * into dest, one run of points contiguous in the image at a time */
+void
+lqr_carver_copy_line(LqrCarver *r, LqrCursor *c, int y, int width, void *dest)
+{
+    int x, u, end;
+    size_t pxl_size = PXL_SIZE(r->col_depth) * r->channels;
+
+    for (x = 0, u = 0; x < width; u = end) {
+        u = lqr_cursor_vis_run(c, y, u, &end);
+        memcpy((char *) dest + x * pxl_size, (char *) r->rgb + ((size_t) y * r->w0 + u) * pxl_size,
+               (end - u) * pxl_size);
+        x += end - u;
     }
-    for (x = 0; x < r->w; x++) {
+}
+
+/* readout all, by line, without copying: each line is returned as
+ * the runs of its pixels which are contiguous in the image buffer;
+ * the spans are valid until the next call, the pixels until the
+ * carver is modified (returns false also when the spans cannot be
+ * allocated, without moving the cursor) */
+/* LQR_PUBLIC */
+bool
+lqr_carver_scan_spans(LqrCarver *r, int *n, LqrSpan **spans, int *n_spans)
+{
+    int x, y, u, end, k;
+    size_t pxl_size;
+    LqrSpan *s;
+
+    if (r->c->eoc) {
+        lqr_carver_scan_reset(r);
+        return false;
+    }
+    LQR_STATS_TIMER(t0);
+    r->spans = LQR_CARVER_RESERVE(r, r->spans, LqrSpan, r->w);
+    if (r->spans == NULL) {
+        return false;
+    }
+    s = r->spans;
+    pxl_size = PXL_SIZE(r->col_depth) * r->channels;
+
+    /* the runs of the line are found by the cursor */
+    y = r->c->y;
+    (*n) = y;
+    for (k = 0, x = 0, u = 0; x < r->w; k++, u = end) {
+        u = lqr_cursor_vis_run(r->c, y, u, &end);
+        s[k].rgb = (char *) r->rgb + ((size_t) y * r->w0 + u) * pxl_size;
+        s[k].x = x;
+        s[k].length = end - u;
+        x += end - u;
+    }
+    lqr_cursor_next_line(r->c);
+
+    (*spans) = s;
+    (*n_spans) = k;
+
+    LQR_STATS_PHASE(r, LQR_STATS_READOUT, t0);
+    return true;
+}
+
+/* pointer to the pixel at (x, y) inside the carver's buffer, found
+ * without scanning the lines (valid until the carver is modified;
+ * returns false if the point is outside the image) */
+/* LQR_PUBLIC */
+bool
+lqr_carver_get_pixel(LqrCarver *r, int x, int y, void **rgb)
+{
+    int line, u;
+
+    if ((x < 0) || (y < 0) || (x >= lqr_carver_get_width(r)) || (y >= lqr_carver_get_height(r))) {
+        return false;
+    }
+
+    lqr_cursor_vis_update(r->c);
+    line = r->transposed ? x : y;
+    u = lqr_cursor_vis_select(r->c, line, r->transposed ? y : x);
+    (*rgb) = (char *) r->rgb + ((size_t) line * r->w0 + u) * PXL_SIZE(r->col_depth) * r->channels;
+    return true;
+}
+
+/* write the whole visible image into dest, by rows also when the
+ * carver is transposed (the rows start row_stride bytes apart),
+ * converting the pixels to col_depth and taking as channel k the
+ * channel channel_order[k] of the carver (NULL keeps the order) */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_export(LqrCarver *r, void *dest, size_t row_stride, LqrColDepth col_depth, const int *channel_order)
+{
+    return lqr_carver_export_region(r, 0, 0, lqr_carver_get_width(r), lqr_carver_get_height(r), dest, row_stride,
+                                    col_depth, channel_order);
+}
+
+/* same as lqr_carver_export, for the width x height rectangle of
+ * the image starting at (x, y); the first point of each line of the
+ * rectangle is found without scanning the line */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_export_region(LqrCarver *r, int x, int y, int width, int height, void *dest, size_t row_stride,
+                         LqrColDepth col_depth, const int *channel_order)
+{
+    LQR_CATCH_F((x >= 0) && (y >= 0) && (width > 0) && (height > 0));
+    LQR_CATCH_F((x + width <= lqr_carver_get_width(r)) && (y + height <= lqr_carver_get_height(r)));
+
+    return lqr_carver_export_cursor(r, r->c, x, y, width, height, dest, row_stride, col_depth, channel_order);
+}
+
+/* write the image at several widths at once, each into its own
+ * buffer as lqr_carver_export would do (if row_strides is NULL the
+ * rows are packed), with a single scan of the visibility map; the
+ * widths must be reachable without computing new maps, and the
+ * carver must not be transposed (the last resize must have changed
+ * the width). The carver's own size is not changed */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_export_widths(LqrCarver *r, int n_widths, const int *widths, void **dest, const size_t *row_strides,
+                         LqrColDepth col_depth, const int *channel_order)
+{
+    int i, j, k, kp, x, y, vs;
+    int *order, *level, *pos, *start, *seq;
+    const int *row;
+    size_t pxl_size, out_pxl_size, row_stride;
+    unsigned char *out;
+    bool direct;
+
+    LQR_CATCH_F((n_widths > 0) && (widths != NULL) && (dest != NULL));
+    LQR_CATCH_F(!r->transposed);
+    LQR_CATCH_F((col_depth >= LQR_COLDEPTH_8I) && (col_depth <= LQR_COLDEPTH_64F));
+    pxl_size = (size_t) r->channels * PXL_SIZE(r->col_depth);
+    out_pxl_size = (size_t) r->channels * PXL_SIZE(col_depth);
+    for (i = 0; i < n_widths; i++) {
+        LQR_CATCH_F((widths[i] >= r->w_start - r->max_level + 1) && (widths[i] <= r->w0));
+        LQR_CATCH_F(dest[i] != NULL);
+        if (row_strides) {
+            LQR_CATCH_F(row_strides[i] >= widths[i] * out_pxl_size);
+            LQR_CATCH_F(row_strides[i] % PXL_SIZE(col_depth) == 0);
+        }
+    }
+
+    direct = (col_depth == r->col_depth);
+    if (channel_order) {
         for (k = 0; k < r->channels; k++) {
-            PXL_COPY(r->rgb_ro_buffer, x * r->channels + k, r->rgb, r->c->now * r->channels + k, r->col_depth);
+            LQR_CATCH_F((channel_order[k] >= 0) && (channel_order[k] < r->channels));
+            if (channel_order[k] != k) {
+                direct = false;
+            }
         }
-        lqr_cursor_next(r->c);
     }
 
-    BUF_POINTER_COPY(rgb, r->rgb_ro_buffer, r->col_depth);
+    LQR_STATS_TIMER(t0);
 
-    return true;
+    LQR_CATCH_MEM(order = LQR_CARVER_RESERVE(r, NULL, int, 4 * n_widths + r->w0));
+    level = order + n_widths;
+    pos = level + n_widths;
+    start = pos + n_widths;
+    seq = start + n_widths;
+
+    /* the outputs are sorted by level: then, the ones at which a point
+     * is visible (vs == 0 or vs >= level) are the first k of them */
+    for (i = 0; i < n_widths; i++) {
+        for (j = i; (j > 0) && (widths[order[j - 1]] < widths[i]); j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+    for (j = 0; j < n_widths; j++) {
+        level[j] = r->w0 - widths[order[j]] + 1;
+    }
+
+    for (y = 0; y < r->h; y++) {
+        row = r->vs + (size_t) y * r->w0;
+        for (x = 0; x < r->w0; x++) {
+            seq[x] = y * r->w0 + x;
+        }
+        for (j = 0; j < n_widths; j++) {
+            pos[j] = 0;
+        }
+
+        /* the runs of visible points of each output are opened and
+         * closed as the number k of outputs seeing the point changes */
+        for (x = 0, kp = 0; x <= r->w0; x++, kp = k) {
+            if (x == r->w0) {
+                k = 0;
+            } else {
+                vs = row[x];
+                k = kp;
+                if (vs == 0) {
+                    k = n_widths;
+                } else {
+                    while ((k < n_widths) && (level[k] <= vs)) {
+                        k++;
+                    }
+                    while ((k > 0) && (level[k - 1] > vs)) {
+                        k--;
+                    }
+                }
+            }
+            for (j = k; j < kp; j++) {
+                i = order[j];
+                row_stride = row_strides ? row_strides[i] : widths[i] * out_pxl_size;
+                out = (unsigned char *) dest[i] + y * row_stride + pos[j] * out_pxl_size;
+                if (direct) {
+                    memcpy(out, (unsigned char *) r->rgb + ((size_t) y * r->w0 + start[j]) * pxl_size,
+                           (x - start[j]) * pxl_size);
+                } else {
+                    lqr_carver_export_pixels(r, out, seq + start[j], 1, x - start[j], col_depth, channel_order);
+                }
+                pos[j] += x - start[j];
+            }
+            for (j = kp; j < k; j++) {
+                start[j] = x;
+            }
+        }
+
+#ifdef __LQR_DEBUG__
+        for (j = 0; j < n_widths; j++) {
+            assert(pos[j] == widths[order[j]]);
+        }
+#endif /* __LQR_DEBUG__ */
+    }
+
+    LRQ_FREE(order);
+
+    LQR_STATS_PHASE(r, LQR_STATS_READOUT, t0);
+    return LQR_OK;
+}
+
+/* write a rectangle of the image, as seen by the cursor c, into
+ * dest (see lqr_carver_export_region, the rectangle must be inside
+ * the image); c may be the cursor of a reader, which scans the
+ * carver at another level */
+LqrRetVal
+lqr_carver_export_cursor(LqrCarver *r, LqrCursor *c, int x, int y, int width, int height, void *dest,
+                         size_t row_stride, LqrColDepth col_depth, const int *channel_order)
+{
+    int i, j, u, end, k, line;
+    int i0, i1, j0, j1;
+    int l0, p0, n_lines, m;
+    size_t pxl_size, out_pxl_size;
+    bool direct;
+    int *idx;
+    unsigned char *out = (unsigned char *) dest;
+
+    LQR_CATCH_F(dest != NULL);
+    LQR_CATCH_F((col_depth >= LQR_COLDEPTH_8I) && (col_depth <= LQR_COLDEPTH_64F));
+    pxl_size = (size_t) r->channels * PXL_SIZE(r->col_depth);
+    out_pxl_size = (size_t) r->channels * PXL_SIZE(col_depth);
+    LQR_CATCH_F(row_stride >= width * out_pxl_size);
+    LQR_CATCH_F(row_stride % PXL_SIZE(col_depth) == 0);
+
+    direct = (col_depth == r->col_depth);
+    if (channel_order) {
+        for (k = 0; k < r->channels; k++) {
+            LQR_CATCH_F((channel_order[k] >= 0) && (channel_order[k] < r->channels));
+            if (channel_order[k] != k) {
+                direct = false;
+            }
+        }
+    }
+
+    LQR_STATS_TIMER(t0);
+
+    /* the rectangle holds n_lines lines of the carver, starting
+     * from line l0, and m points of each line, starting from the
+     * visible point p0 */
+    l0 = r->transposed ? x : y;
+    p0 = r->transposed ? y : x;
+    n_lines = r->transposed ? width : height;
+    m = r->transposed ? height : width;
+
+    /* the runs of visible points are found by the cursor */
+    lqr_cursor_vis_update(c);
+
+    /* the lines are the rows: without conversions, the runs are
+     * copied at once */
+    if (!r->transposed && direct) {
+        for (i = 0; i < n_lines; i++) {
+            line = l0 + i;
+            for (j = 0, u = lqr_cursor_vis_select(c, line, p0); j < m; u = end) {
+                u = lqr_cursor_vis_run(c, line, u, &end);
+                end = MIN(end, u + m - j);
+                memcpy(out + i * row_stride + j * pxl_size, (unsigned char *) r->rgb + ((size_t) line * r->w0 + u) * pxl_size,
+                       (end - u) * pxl_size);
+                j += end - u;
+            }
+        }
+        LQR_STATS_PHASE(r, LQR_STATS_READOUT, t0);
+        return LQR_OK;
+    }
+
+    /* otherwise, the indices of the visible points are collected
+     * one strip of lines at a time */
+    LQR_CATCH_MEM(idx = LQR_CARVER_RESERVE(r, NULL, int, LQR_TRANSPOSE_TILE * m));
+
+    for (i0 = 0; i0 < n_lines; i0 += LQR_TRANSPOSE_TILE) {
+        i1 = MIN(i0 + LQR_TRANSPOSE_TILE, n_lines);
+        for (i = i0; i < i1; i++) {
+            line = l0 + i;
+            for (j = 0, u = lqr_cursor_vis_select(c, line, p0); j < m; u = end) {
+                u = lqr_cursor_vis_run(c, line, u, &end);
+                end = MIN(end, u + m - j);
+                for (; u < end; u++) {
+                    idx[(i - i0) * m + j++] = line * r->w0 + u;
+                }
+            }
+        }
+
+        if (!r->transposed) {
+            for (i = i0; i < i1; i++) {
+                lqr_carver_export_pixels(r, out + i * row_stride, idx + (i - i0) * m, 1, m, col_depth, channel_order);
+            }
+        } else if (direct && (row_stride % pxl_size == 0)) {
+            /* the lines are the columns: without conversions, they
+             * are transposed in tiles */
+            for (j0 = 0; j0 < m; j0 += LQR_TRANSPOSE_TILE) {
+                j1 = MIN(j0 + LQR_TRANSPOSE_TILE, m);
+                lqr_carver_transpose_tile(dest, r->rgb, idx, m, row_stride / pxl_size, j0, j1, i0, i1, pxl_size);
+            }
+        } else {
+            for (j = 0; j < m; j++) {
+                lqr_carver_export_pixels(r, out + j * row_stride + i0 * out_pxl_size, idx + j, m, i1 - i0,
+                                         col_depth, channel_order);
+            }
+        }
+    }
+
+    LRQ_FREE(idx);
+
+    LQR_STATS_PHASE(r, LQR_STATS_READOUT, t0);
+    return LQR_OK;
+}
+
+/* write n pixels into dest, reading them at the map positions
+ * idx[0], idx[idx_step], ... and converting them (see above) */
+void
+lqr_carver_export_pixels(LqrCarver *r, void *dest, const int *idx, int idx_step, int n, LqrColDepth col_depth,
+                         const int *channel_order)
+{
+    int i, k, src, dest_ind;
+
+    for (i = 0; i < n; i++) {
+        src = idx[i * idx_step] * r->channels;
+        dest_ind = i * r->channels;
+        for (k = 0; k < r->channels; k++) {
+            if (col_depth == r->col_depth) {
+                PXL_COPY(dest, dest_ind + k, r->rgb, src + (channel_order ? channel_order[k] : k), col_depth);
+            } else {
+                lqr_pixel_set_norm(lqr_pixel_get_norm(r->rgb, src + (channel_order ? channel_order[k] : k),
+                                                      r->col_depth), dest, dest_ind + k, col_depth);
+            }
+        }
+    }
 }
 
 #ifdef __LQR_DEBUG__
@@ -60,8 +60,9 @@ lqr_carver_bias_add_xy(LqrCarver *r, double bias, int x, int y)
         LQR_CATCH(lqr_carver_flatten(r));
     }
     if (r->bias == NULL) {
-        LQR_CATCH_MEM(r->bias = LRQ_CALLOC(float, r->w0 * r->h0));
+        LQR_CATCH_MEM(r->bias = LQR_CARVER_CALLOC(r, float, r->w0 * r->h0));
     }
+    LQR_CARVER_UNSHARE_RET_LQR(r, r->bias);
 
     xt = r->transposed ? y : x;
     yt = r->transposed ? x : y;
@@ -99,8 +100,9 @@ lqr_carver_bias_add_area(LqrCarver *r, double *buffer, int bias_factor, int widt
     }
 
     if (r->bias == NULL) {
-        LQR_CATCH_MEM(r->bias = LRQ_CALLOC(float, r->w * r->h));
+        LQR_CATCH_MEM(r->bias = LQR_CARVER_CALLOC(r, float, r->w * r->h));
     }
+    LQR_CARVER_UNSHARE_RET_LQR(r, r->bias);
 
     wt = r->transposed ? r->h : r->w;
     ht = r->transposed ? r->w : r->h;
@@ -163,8 +165,9 @@ lqr_carver_bias_add_rgb_area(LqrCarver *r, uint8_t *rgb, int bias_factor, int ch
     }
 
     if (r->bias == NULL) {
-        LQR_CATCH_MEM(r->bias = LRQ_CALLOC(float, r->w * r->h));
+        LQR_CATCH_MEM(r->bias = LQR_CARVER_CALLOC(r, float, r->w * r->h));
     }
+    LQR_CARVER_UNSHARE_RET_LQR(r, r->bias);
 
     has_alpha = (channels == 2 || channels >= 4);
     c_channels = channels - (has_alpha ? 1 : 0);
@@ -0,0 +1,609 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+
+#include "lqr_all.h"
+
+#ifdef __LQR_DEBUG__
+#include <assert.h>
+#endif /* __LQR_DEBUG__ */
+
+/**** LQR_CARVER_DUAL STRUCT FUNCTIONS ****/
+
+/* keep the multisize maps of both orientations: the resizes are
+ * then computed from the base image (the one found at the first
+ * resize) rather than from the result of the previous one, and a
+ * size already covered by the maps is reached by just changing the
+ * visibility level, even when the other axis was resized in between;
+ * this needs up to three times the memory of a single carver */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_dual_cache(LqrCarver *r, bool enable)
+{
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_CANC(r);
+    LQR_CATCH_F(atomic_load(&r->state) == LQR_CARVER_STATE_STD);
+
+    if (!enable) {
+        lqr_carver_dual_clear(r);
+    }
+    r->dual.enabled = enable;
+
+    return LQR_OK;
+}
+
+/* resize through the cache: a change of a single axis is served by
+ * the base state of that axis, a change of both by the base state
+ * of the first axis (as set by the resize order) followed by the
+ * mixed state built on its result; so, the sizes reached by only
+ * changing the second axis are served without computing new maps */
+LqrRetVal
+lqr_carver_dual_resize(LqrCarver *r, int w1, int h1)
+{
+    LqrCarverDual *d = &r->dual;
+    LqrRetVal ret_val;
+
+    /* the image was changed outside of the cache (e.g. flattened) */
+    if ((d->width == 0) || (d->active < 0) || (d->rgb_serial != r->rgb_serial)) {
+        LQR_CATCH(lqr_carver_dual_capture(r));
+    }
+
+    /* the states must not be flattened, as it happens when enlarging
+     * by more than one step: leave those resizes to the carver alone */
+    if (!r->active || !lqr_carver_dual_in_range(r, w1, d->width) || !lqr_carver_dual_in_range(r, h1, d->height)) {
+        lqr_carver_dual_clear(r);
+        return lqr_carver_resize_ordered(r, w1, h1);
+    }
+
+    if (h1 == d->height) {
+        ret_val = lqr_carver_dual_select(r, LQR_DUAL_WIDTH, 0);
+        if (ret_val == LQR_OK) {
+            ret_val = lqr_carver_resize_width(r, w1);
+        }
+    } else if (w1 == d->width) {
+        ret_val = lqr_carver_dual_select(r, LQR_DUAL_HEIGHT, 0);
+        if (ret_val == LQR_OK) {
+            ret_val = lqr_carver_resize_height(r, h1);
+        }
+    } else if (r->resize_order == LQR_RES_ORDER_HOR) {
+        ret_val = lqr_carver_dual_select(r, LQR_DUAL_WIDTH, 0);
+        if (ret_val == LQR_OK) {
+            ret_val = lqr_carver_resize_width(r, w1);
+        }
+        if (ret_val == LQR_OK) {
+            ret_val = lqr_carver_dual_select(r, LQR_DUAL_MIXED_HOR, w1);
+        }
+        if (ret_val == LQR_OK) {
+            ret_val = lqr_carver_resize_height(r, h1);
+        }
+    } else {
+        ret_val = lqr_carver_dual_select(r, LQR_DUAL_HEIGHT, 0);
+        if (ret_val == LQR_OK) {
+            ret_val = lqr_carver_resize_height(r, h1);
+        }
+        if (ret_val == LQR_OK) {
+            ret_val = lqr_carver_dual_select(r, LQR_DUAL_MIXED_VERT, h1);
+        }
+        if (ret_val == LQR_OK) {
+            ret_val = lqr_carver_resize_width(r, w1);
+        }
+    }
+
+    /* after a failure only the state held by the carver is kept */
+    if (ret_val != LQR_OK) {
+        lqr_carver_dual_clear(r);
+        return ret_val;
+    }
+
+    d->rgb_serial = r->rgb_serial;
+    return LQR_OK;
+}
+
+/* whether a size along an axis whose base size is size0 can be
+ * reached without flattening (see lqr_carver_resize_width) */
+bool
+lqr_carver_dual_in_range(LqrCarver *r, int size, int size0)
+{
+    int delta_max = MAX((int) ((r->enl_step - 1) * size0) - 1, 1);
+
+    return size <= size0 + delta_max;
+}
+
+/* take the current image as the base one; the carver state
+ * becomes the base state of its orientation */
+LqrRetVal
+lqr_carver_dual_capture(LqrCarver *r)
+{
+    LqrCarverDual *d = &r->dual;
+
+    lqr_carver_dual_clear(r);
+
+    if (r->w != r->w_start) {
+        LQR_CATCH(lqr_carver_flatten(r));
+    }
+
+    d->width = lqr_carver_get_width(r);
+    d->height = lqr_carver_get_height(r);
+    d->active = r->transposed ? LQR_DUAL_HEIGHT : LQR_DUAL_WIDTH;
+    d->rgb_serial = r->rgb_serial;
+
+    return LQR_OK;
+}
+
+/* geometry of the state of a slot: orientation and base size
+ * (key is the first axis size of the mixed states) */
+void
+lqr_carver_dual_geometry(LqrCarver *r, int slot, int key, int *transposed, int *w_start, int *h_start)
+{
+    LqrCarverDual *d = &r->dual;
+
+    switch (slot) {
+        case LQR_DUAL_WIDTH:
+            *transposed = 0;
+            *w_start = d->width;
+            *h_start = d->height;
+            break;
+        case LQR_DUAL_HEIGHT:
+            *transposed = 1;
+            *w_start = d->height;
+            *h_start = d->width;
+            break;
+        case LQR_DUAL_MIXED_HOR:
+            *transposed = 1;
+            *w_start = d->height;
+            *h_start = key;
+            break;
+        default:
+            *transposed = 0;
+            *w_start = d->width;
+            *h_start = key;
+            break;
+    }
+}
+
+/* whether the state held by the carver is the one of the slot */
+bool
+lqr_carver_dual_fits(LqrCarver *r, int slot, int key)
+{
+    int transposed, w_start, h_start;
+
+    lqr_carver_dual_geometry(r, slot, key, &transposed, &w_start, &h_start);
+    return (r->transposed == transposed) && (r->w_start == w_start) && (r->h_start == h_start);
+}
+
+/* whether the slot holds its state */
+bool
+lqr_carver_dual_parked(LqrCarver *r, int slot, int key)
+{
+    LqrCarverMaps *s = &r->dual.slot[slot];
+    int transposed, w_start, h_start;
+
+    lqr_carver_dual_geometry(r, slot, key, &transposed, &w_start, &h_start);
+    return s->valid && (s->transposed == transposed) && (s->w_start == w_start) && (s->h_start == h_start);
+}
+
+/* make the carver hold the state of the given slot, setting the
+ * current one aside; a missing state is derived from the one it is
+ * built on */
+LqrRetVal
+lqr_carver_dual_select(LqrCarver *r, int slot, int key)
+{
+    LqrCarverDual *d = &r->dual;
+    int source = -1;
+    int view = 0;
+
+    if ((d->active == slot) && lqr_carver_dual_fits(r, slot, key)) {
+        return LQR_OK;
+    }
+
+    if (!lqr_carver_dual_parked(r, slot, key)) {
+        switch (slot) {
+            case LQR_DUAL_WIDTH:
+                source = LQR_DUAL_HEIGHT;
+                break;
+            case LQR_DUAL_HEIGHT:
+                source = LQR_DUAL_WIDTH;
+                break;
+            case LQR_DUAL_MIXED_HOR:
+                source = LQR_DUAL_WIDTH;
+                view = key;
+                break;
+            default:
+                source = LQR_DUAL_HEIGHT;
+                view = key;
+                break;
+        }
+        LQR_CATCH_F(((d->active == source) && lqr_carver_dual_fits(r, source, 0))
+                    || lqr_carver_dual_parked(r, source, 0));
+    }
+
+    /* set the current state aside, unless it is the source, or
+     * drop it if it no longer matches its slot */
+    if ((d->active >= 0) && (d->active != source)) {
+        if (lqr_carver_dual_fits(r, d->active, d->key)) {
+            lqr_carver_dual_park(r, d->active);
+        } else {
+            lqr_carver_dual_park(r, LQR_DUAL_SCRATCH);
+            lqr_carver_dual_drop(r, LQR_DUAL_SCRATCH);
+        }
+        d->active = -1;
+    }
+
+    if (source < 0) {
+        lqr_carver_dual_restore(r, slot);
+    } else {
+        if (d->active != source) {
+            lqr_carver_dual_restore(r, source);
+            d->active = source;
+        }
+        /* a stale state of the slot is replaced */
+        lqr_carver_dual_drop(r, slot);
+        LQR_CATCH(lqr_carver_dual_derive(r, source, view));
+    }
+
+    d->active = slot;
+    d->key = key;
+
+    return LQR_OK;
+}
+
+/* build a new state in the carver by transposing the source state,
+ * held by the carver, at the given width (0 = its base width); the
+ * source state is set aside, and taken back on failure (the caller
+ * makes the new state the one of its slot) */
+LqrRetVal
+lqr_carver_dual_derive(LqrCarver *r, int source, int view)
+{
+    LqrDataTok data_tok;
+    LqrRetVal ret_val;
+
+    view = view ? view : r->w_start;
+    lqr_carver_set_width(r, view);
+    data_tok.integer = view;
+    lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_set_width_attached, data_tok);
+
+    /* the transposition consumes its input: give it a copy */
+    lqr_carver_dual_park(r, source);
+    ret_val = lqr_carver_dual_copy(r, source);
+    if (ret_val == LQR_OK) {
+        ret_val = lqr_carver_transpose(r);
+    }
+
+    if (ret_val != LQR_OK) {
+        lqr_carver_dual_park(r, LQR_DUAL_SCRATCH);
+        lqr_carver_dual_drop(r, LQR_DUAL_SCRATCH);
+        lqr_carver_dual_restore(r, source);
+        r->dual.active = source;
+        return ret_val;
+    }
+
+    return LQR_OK;
+}
+
+/* set the state of the carver and of the attached ones aside */
+void
+lqr_carver_dual_park(LqrCarver *r, int slot)
+{
+    LqrDataTok data_tok;
+
+    lqr_carver_maps_park(r, &r->dual.slot[slot]);
+    data_tok.integer = slot;
+    lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_dual_park_attached, data_tok);
+}
+
+LqrRetVal
+lqr_carver_dual_park_attached(LqrCarver *r, LqrDataTok data)
+{
+    lqr_carver_maps_park(r, &r->dual.slot[data.integer]);
+    return LQR_OK;
+}
+
+/* take back a state set aside (the carver must be holding none) */
+void
+lqr_carver_dual_restore(LqrCarver *r, int slot)
+{
+    LqrDataTok data_tok;
+
+    lqr_carver_maps_restore(r, &r->dual.slot[slot]);
+    data_tok.integer = slot;
+    lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_dual_restore_attached, data_tok);
+
+    /* the attached carvers share the visibility map */
+    data_tok.data = NULL;
+    lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_propagate_vsmap_attached, data_tok);
+    lqr_cursor_reset(r->c);
+}
+
+LqrRetVal
+lqr_carver_dual_restore_attached(LqrCarver *r, LqrDataTok data)
+{
+    lqr_carver_maps_restore(r, &r->dual.slot[data.integer]);
+    return LQR_OK;
+}
+
+/* give the carver and the attached ones a copy of the image
+ * related maps of a state set aside */
+LqrRetVal
+lqr_carver_dual_copy(LqrCarver *r, int slot)
+{
+    LqrDataTok data_tok;
+
+    LQR_CATCH(lqr_carver_maps_copy(r, &r->dual.slot[slot]));
+    data_tok.integer = slot;
+    return lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_dual_copy_attached, data_tok);
+}
+
+LqrRetVal
+lqr_carver_dual_copy_attached(LqrCarver *r, LqrDataTok data)
+{
+    return lqr_carver_maps_copy(r, &r->dual.slot[data.integer]);
+}
+
+/* free the state of a slot, for the carver and the attached ones */
+void
+lqr_carver_dual_drop(LqrCarver *r, int slot)
+{
+    LqrDataTok data_tok;
+
+    lqr_carver_maps_free(r, &r->dual.slot[slot]);
+    data_tok.integer = slot;
+    lqr_carver_list_foreach_recursive(r->attached_list, lqr_carver_dual_drop_attached, data_tok);
+}
+
+LqrRetVal
+lqr_carver_dual_drop_attached(LqrCarver *r, LqrDataTok data)
+{
+    lqr_carver_maps_free(r, &r->dual.slot[data.integer]);
+    return LQR_OK;
+}
+
+/* free all the states set aside and forget the base image
+ * (the state held by the carver is kept) */
+void
+lqr_carver_dual_clear(LqrCarver *r)
+{
+    int slot;
+
+    for (slot = 0; slot < LQR_DUAL_N_SLOTS; slot++) {
+        lqr_carver_dual_drop(r, slot);
+    }
+    r->dual.width = 0;
+    r->dual.height = 0;
+    r->dual.active = -1;
+}
+
+/* free the states set aside by a single carver */
+void
+lqr_carver_dual_free(LqrCarver *r)
+{
+    int slot;
+
+    for (slot = 0; slot < LQR_DUAL_N_SLOTS; slot++) {
+        lqr_carver_maps_free(r, &r->dual.slot[slot]);
+    }
+}
+
+/**** LQR_CARVER_MAPS STRUCT FUNCTIONS ****/
+
+/* move the image and the maps of a carver to s, along with its
+ * geometry (which is left in the carver as well) */
+void
+lqr_carver_maps_park(LqrCarver *r, LqrCarverMaps *s)
+{
+#ifdef __LQR_DEBUG__
+    assert(!s->valid);
+#endif /* __LQR_DEBUG__ */
+
+    s->valid = true;
+    s->w_start = r->w_start;
+    s->h_start = r->h_start;
+    s->w = r->w;
+    s->h = r->h;
+    s->w0 = r->w0;
+    s->h0 = r->h0;
+    s->level = r->level;
+    s->max_level = r->max_level;
+    s->transposed = r->transposed;
+    s->leftright = r->leftright;
+    s->nrg_uptodate = r->nrg_uptodate;
+
+    s->rgb = r->rgb;
+    s->rgb_user = r->rgb_user;
+    s->preserve_in_buffer = r->preserve_in_buffer;
+    if (r->root == NULL) {
+        s->vs = r->vs;
+        r->vs = NULL;
+    }
+    s->en = r->en;
+    s->bias = r->bias;
+    s->m = r->m;
+    s->least = r->least;
+    s->least_dx = r->least_dx;
+    s->_raw = r->_raw;
+    s->raw = r->raw;
+    s->rigidity_map = r->rigidity_map;
+    s->rigidity_mask = r->rigidity_mask;
+    s->rgb_ro_buffer = r->rgb_ro_buffer;
+    s->vpath = r->vpath;
+    s->vpath_x = r->vpath_x;
+    s->nrg_xmin = r->nrg_xmin;
+    s->nrg_xmax = r->nrg_xmax;
+    s->carved_xmin = r->carved_xmin;
+    s->carved_xmax = r->carved_xmax;
+    s->rcache = r->rcache;
+
+    r->rgb = NULL;
+    r->rgb_user = false;
+    r->preserve_in_buffer = false;
+    r->en = NULL;
+    r->bias = NULL;
+    r->m = NULL;
+    r->least = NULL;
+    r->least_dx = NULL;
+    r->_raw = NULL;
+    r->raw = NULL;
+    r->rigidity_map = NULL;
+    r->rigidity_mask = NULL;
+    r->rgb_ro_buffer = NULL;
+    r->vpath = NULL;
+    r->vpath_x = NULL;
+    r->nrg_xmin = NULL;
+    r->nrg_xmax = NULL;
+    r->carved_xmin = NULL;
+    r->carved_xmax = NULL;
+    r->rcache = NULL;
+    r->nrg_uptodate = false;
+}
+
+/* move a state set aside back to the carver */
+void
+lqr_carver_maps_restore(LqrCarver *r, LqrCarverMaps *s)
+{
+#ifdef __LQR_DEBUG__
+    assert(s->valid);
+    assert(r->rgb == NULL);
+#endif /* __LQR_DEBUG__ */
+
+    r->w_start = s->w_start;
+    r->h_start = s->h_start;
+    r->w = s->w;
+    r->h = s->h;
+    r->w0 = s->w0;
+    r->h0 = s->h0;
+    r->level = s->level;
+    r->max_level = s->max_level;
+    r->transposed = s->transposed;
+    r->leftright = s->leftright;
+    r->nrg_uptodate = s->nrg_uptodate;
+
+    r->rgb = s->rgb;
+    r->rgb_user = s->rgb_user;
+    r->preserve_in_buffer = s->preserve_in_buffer;
+    if (r->root == NULL) {
+        r->vs = s->vs;
+        r->vs_serial++;
+    }
+    r->en = s->en;
+    r->bias = s->bias;
+    r->m = s->m;
+    r->least = s->least;
+    r->least_dx = s->least_dx;
+    r->_raw = s->_raw;
+    r->raw = s->raw;
+    r->rigidity_map = s->rigidity_map;
+    r->rigidity_mask = s->rigidity_mask;
+    r->rgb_ro_buffer = s->rgb_ro_buffer;
+    r->vpath = s->vpath;
+    r->vpath_x = s->vpath_x;
+    r->nrg_xmin = s->nrg_xmin;
+    r->nrg_xmax = s->nrg_xmax;
+    r->carved_xmin = s->carved_xmin;
+    r->carved_xmax = s->carved_xmax;
+    r->rcache = s->rcache;
+
+    memset(s, 0, sizeof(LqrCarverMaps));
+}
+
+/* give the carver (which must be holding no state) a copy of the
+ * maps of s which are read to build the transposed image; the
+ * others are rebuilt anyway */
+LqrRetVal
+lqr_carver_maps_copy(LqrCarver *r, LqrCarverMaps *s)
+{
+    int size = s->w0 * s->h0;
+
+    BUF_TRY_RESERVE_RET_LQR(r, r->rgb, r->rgb_spare, size * r->channels, r->col_depth);
+    memcpy(r->rgb, s->rgb, size * r->channels * PXL_SIZE(r->col_depth));
+
+    if (s->vs) {
+        r->vs = LQR_CARVER_RESERVE(r, r->vs_spare, int, size);
+        r->vs_spare = NULL;
+        LQR_CATCH_MEM(r->vs);
+        memcpy(r->vs, s->vs, size * sizeof(int));
+        r->vs_serial++;
+    }
+    if (s->bias) {
+        r->bias = LQR_CARVER_RESERVE(r, r->bias_spare, float, size);
+        r->bias_spare = NULL;
+        LQR_CATCH_MEM(r->bias);
+        memcpy(r->bias, s->bias, size * sizeof(float));
+    }
+    if (s->rigidity_mask) {
+        r->rigidity_mask = LQR_CARVER_RESERVE(r, r->rigmask_spare, float, size);
+        r->rigmask_spare = NULL;
+        LQR_CATCH_MEM(r->rigidity_mask);
+        memcpy(r->rigidity_mask, s->rigidity_mask, size * sizeof(float));
+    }
+    if (s->rigidity_map) {
+        LQR_CATCH_MEM(r->rigidity_map = LQR_CARVER_CALLOC(r, float, 2 * r->delta_x + 1));
+        r->rigidity_map += r->delta_x;
+        memcpy(r->rigidity_map - r->delta_x, s->rigidity_map - r->delta_x, (2 * r->delta_x + 1) * sizeof(float));
+    }
+
+    return LQR_OK;
+}
+
+/* free a state set aside (the image buffer is treated as in
+ * lqr_carver_rgb_free) */
+void
+lqr_carver_maps_free(LqrCarver *r, LqrCarverMaps *s)
+{
+    if (!s->valid) {
+        return;
+    }
+
+    if (!s->preserve_in_buffer) {
+        if (s->rgb_user) {
+            LQR_USER_FREE(s->rgb);
+        } else {
+            LRQ_FREE(s->rgb);
+        }
+    }
+    LRQ_FREE(s->vs);
+    LRQ_FREE(s->en);
+    LRQ_FREE(s->bias);
+    LRQ_FREE(s->m);
+    LRQ_FREE(s->least);
+    LRQ_FREE(s->least_dx);
+    LRQ_FREE(s->_raw);
+    LRQ_FREE(s->raw);
+    if (s->rigidity_map != NULL) {
+        s->rigidity_map -= r->delta_x;
+        LRQ_FREE(s->rigidity_map);
+    }
+    LRQ_FREE(s->rigidity_mask);
+    LRQ_FREE(s->rgb_ro_buffer);
+    LRQ_FREE(s->vpath);
+    LRQ_FREE(s->vpath_x);
+    LRQ_FREE(s->nrg_xmin);
+    LRQ_FREE(s->nrg_xmax);
+    LRQ_FREE(s->carved_xmin);
+    LRQ_FREE(s->carved_xmax);
+    LRQ_FREE(s->rcache);
+
+    memset(s, 0, sizeof(LqrCarverMaps));
+}
@@ -0,0 +1,131 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_CARVER_DUAL_PRIV_H__
+#define __LQR_CARVER_DUAL_PRIV_H__
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_carver_dual_priv.h"
+#endif /* __LQR_BASE_H__ */
+
+#ifndef __LQR_CARVER_LIST_H__
+#error "lqr_carver_list.h must be included prior to lqr_carver_dual_priv.h"
+#endif /* __LQR_CARVER_LIST_H__ */
+
+/* Slots of the dual orientation cache */
+enum _LqrCarverDualSlot {
+    LQR_DUAL_WIDTH,                     /* base image, vertical seams */
+    LQR_DUAL_HEIGHT,                    /* base image, horizontal seams */
+    LQR_DUAL_MIXED_HOR,                 /* base image resized in width, horizontal seams */
+    LQR_DUAL_MIXED_VERT,                /* base image resized in height, vertical seams */
+    LQR_DUAL_SCRATCH,                   /* states being dropped */
+    LQR_DUAL_N_SLOTS
+};
+
+typedef enum _LqrCarverDualSlot LqrCarverDualSlot;
+
+/**** LQR_CARVER_DUAL STRUCT DEFINITION ****/
+
+/* A carver state set aside: the image with all the maps needed to
+ * change its size or to carve it further, and its geometry */
+struct _LqrCarverMaps {
+    bool valid;                         /* whether the slot holds a state */
+
+    int w_start, h_start;
+    int w, h;
+    int w0, h0;
+    int level;
+    int max_level;
+    int transposed;
+    int leftright;
+
+    void *rgb;
+    bool rgb_user;
+    bool preserve_in_buffer;
+    int *vs;                            /* only for the root carver */
+    float *en;
+    float *bias;
+    float *m;
+    int *least;
+    int8_t *least_dx;
+    int *_raw;
+    int **raw;
+    float *rigidity_map;
+    float *rigidity_mask;
+    void *rgb_ro_buffer;
+    int *vpath;
+    int *vpath_x;
+    int *nrg_xmin;
+    int *nrg_xmax;
+    int *carved_xmin;
+    int *carved_xmax;
+    double *rcache;
+    bool nrg_uptodate;
+};
+
+typedef struct _LqrCarverMaps LqrCarverMaps;
+
+/* The multisize states of a base image in both orientations, and
+ * the last one computed for a two-axis resize in each resize order,
+ * so that the carver can switch between them instead of flattening
+ * and transposing */
+struct _LqrCarverDual {
+    bool enabled;                       /* whether resizes go through the cache */
+    int width;                          /* size of the base image */
+    int height;                         /* (0 = no base image yet) */
+    int key;                            /* first axis size of the active mixed state */
+    int active;                         /* slot of the state held by the carver (-1 = none) */
+    unsigned int rgb_serial;            /* image buffer serial when the cache was last used */
+    LqrCarverMaps slot[LQR_DUAL_N_SLOTS];
+};
+
+typedef struct _LqrCarverDual LqrCarverDual;
+
+/* LQR_CARVER_DUAL PRIVATE FUNCTIONS */
+
+LqrRetVal lqr_carver_dual_resize(LqrCarver *r, int w1, int h1);
+bool lqr_carver_dual_in_range(LqrCarver *r, int size, int size0);
+LqrRetVal lqr_carver_dual_capture(LqrCarver *r);
+void lqr_carver_dual_geometry(LqrCarver *r, int slot, int key, int *transposed, int *w_start, int *h_start);
+bool lqr_carver_dual_fits(LqrCarver *r, int slot, int key);
+bool lqr_carver_dual_parked(LqrCarver *r, int slot, int key);
+LqrRetVal lqr_carver_dual_select(LqrCarver *r, int slot, int key);
+LqrRetVal lqr_carver_dual_derive(LqrCarver *r, int source, int view);
+void lqr_carver_dual_park(LqrCarver *r, int slot);
+void lqr_carver_dual_restore(LqrCarver *r, int slot);
+LqrRetVal lqr_carver_dual_copy(LqrCarver *r, int slot);
+void lqr_carver_dual_drop(LqrCarver *r, int slot);
+void lqr_carver_dual_clear(LqrCarver *r);
+void lqr_carver_dual_free(LqrCarver *r);
+
+void lqr_carver_maps_park(LqrCarver *r, LqrCarverMaps *s);
+void lqr_carver_maps_restore(LqrCarver *r, LqrCarverMaps *s);
+LqrRetVal lqr_carver_maps_copy(LqrCarver *r, LqrCarverMaps *s);
+void lqr_carver_maps_free(LqrCarver *r, LqrCarverMaps *s);
+
+/* auxiliary */
+LqrRetVal lqr_carver_dual_park_attached(LqrCarver *r, LqrDataTok data);
+LqrRetVal lqr_carver_dual_restore_attached(LqrCarver *r, LqrDataTok data);
+LqrRetVal lqr_carver_dual_copy_attached(LqrCarver *r, LqrDataTok data);
+LqrRetVal lqr_carver_dual_drop_attached(LqrCarver *r, LqrDataTok data);
+
+#endif /* __LQR_CARVER_DUAL_PRIV_H__ */
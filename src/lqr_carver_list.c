@@ -62,8 +62,9 @@ lqr_carver_list_destroy(LqrCarverList *list)
     LqrCarverList *now = list;
     if (now != NULL) {
         lqr_carver_list_destroy(now->next);
-        lqr_carver_list_destroy(now->current->attached_list);
+        /* this also destroys the carvers attached to it */
         lqr_carver_destroy(now->current);
+        LRQ_FREE(now);
     }
 }
 
@@ -25,7 +25,7 @@
 /* Macros for update_mmap speedup : without rigidity */
 
 #define DATADOWN(y, x) (r->raw[(y) - 1][(x)])
-#define MDOWN(y, x) (r->m[DATADOWN((y), (x))])
+#define MDOWN(y, x) (r->m[LQR_MAP_INDEX(r, (x), (y) - 1)])
 
 #define MMIN01G(y, x) (least = DATADOWN((y), (x)), MDOWN((y), (x)))
 #define MMINTESTL(y, x1, x2) (MDOWN((y), (x1)) <= MDOWN((y), (x2)))
@@ -57,7 +57,7 @@
 
 /* Macros for update_mmap speedup : with rigidity */
 
-#define MRDOWN(y, x, dx) (r->m[DATADOWN((y), (x))] + r_fact * r->rigidity_map[(dx)])
+#define MRDOWN(y, x, dx) (MDOWN((y), (x)) + r_fact * r->rigidity_map[(dx)])
 
 #define MRSET01(y, x, dx) (mc[(dx)] = MRDOWN((y), (x), (dx)))
 #define MRSET02(y, x, dx) (MRSET01((y), (x), (dx)), MRSET01((y), (x) + 1, (dx) + 1))
@@ -25,6 +25,7 @@
 
 #include <stdbool.h>
 #include <stdatomic.h>
+#include <pthread.h>
 
 #ifndef __LQR_BASE_H__
 #error "lqr_base.h must be included prior to lqr_carver.h"
@@ -54,6 +55,34 @@
 #error "lqr_vmap_list.h must be included prior to lqr_carver_priv.h"
 #endif /* __LQR_VMAP_LIST_H__ */
 
+#ifndef __LQR_THREAD_POOL_H__
+#error "lqr_thread_pool.h must be included prior to lqr_carver_priv.h"
+#endif /* __LQR_THREAD_POOL_H__ */
+
+#ifndef __LQR_CARVER_PYRAMID_H__
+#error "lqr_carver_pyramid.h must be included prior to lqr_carver_priv.h"
+#endif /* __LQR_CARVER_PYRAMID_H__ */
+
+#ifndef __LQR_CARVER_DUAL_H__
+#error "lqr_carver_dual.h must be included prior to lqr_carver_priv.h"
+#endif /* __LQR_CARVER_DUAL_H__ */
+
+#ifndef __LQR_MINPATH_H__
+#error "lqr_minpath.h must be included prior to lqr_carver_priv.h"
+#endif /* __LQR_MINPATH_H__ */
+
+#ifndef __LQR_CPU_H__
+#error "lqr_cpu.h must be included prior to lqr_carver_priv.h"
+#endif /* __LQR_CPU_H__ */
+
+#ifndef __LQR_STATS_H__
+#error "lqr_stats.h must be included prior to lqr_carver_priv.h"
+#endif /* __LQR_STATS_H__ */
+
+#ifndef __LQR_MEM_H__
+#error "lqr_mem.h must be included prior to lqr_carver_priv.h"
+#endif /* __LQR_MEM_H__ */
+
 /* Macros for internal use */
 
 #define AS0_8I(x) ((lqr_t_8i)(x))
@@ -71,6 +100,12 @@
 #define AS2_32F(x) ((lqr_t_32f**)(x))
 #define AS2_64F(x) ((lqr_t_64f**)(x))
 
+/* size in bytes of a colour channel */
+#define PXL_SIZE(col_depth) \
+  ((col_depth) == LQR_COLDEPTH_8I ? sizeof(lqr_t_8i) : \
+   (col_depth) == LQR_COLDEPTH_16I ? sizeof(lqr_t_16i) : \
+   (col_depth) == LQR_COLDEPTH_32F ? sizeof(lqr_t_32f) : sizeof(lqr_t_64f))
+
 #define PXL_COPY(dest, dest_ind, src, src_ind, col_depth) do { \
   switch (col_depth) \
     { \
@@ -107,58 +142,101 @@
     } \
 } while(0)
 
-#define BUF_TRY_NEW_RET_POINTER(dest, size, col_depth) do { \
+#define BUF_TRY_NEW_RET_POINTER(r, dest, size, col_depth) do { \
+  switch (col_depth) \
+    { \
+      case LQR_COLDEPTH_8I: \
+        LQR_TRY_N_N ((dest) = LQR_CARVER_CALLOC ((r), lqr_t_8i, (size))); \
+        break; \
+      case LQR_COLDEPTH_16I: \
+        LQR_TRY_N_N ((dest) = LQR_CARVER_CALLOC ((r), lqr_t_16i, (size))); \
+        break; \
+      case LQR_COLDEPTH_32F: \
+        LQR_TRY_N_N ((dest) = LQR_CARVER_CALLOC ((r), lqr_t_32f, (size))); \
+        break; \
+      case LQR_COLDEPTH_64F: \
+        LQR_TRY_N_N ((dest) = LQR_CARVER_CALLOC ((r), lqr_t_64f, (size))); \
+        break; \
+    } \
+} while(0)
+
+#define BUF_TRY_NEW0_RET_POINTER(r, dest, size, col_depth) do { \
   switch (col_depth) \
     { \
       case LQR_COLDEPTH_8I: \
-        LQR_TRY_N_N ((dest) = LRQ_CALLOC (lqr_t_8i, (size))); \
+        LQR_TRY_N_N ((dest) = LQR_CARVER_CALLOC ((r), lqr_t_8i, (size))); \
         break; \
       case LQR_COLDEPTH_16I: \
-        LQR_TRY_N_N ((dest) = LRQ_CALLOC (lqr_t_16i, (size))); \
+        LQR_TRY_N_N ((dest) = LQR_CARVER_CALLOC ((r), lqr_t_16i, (size))); \
         break; \
       case LQR_COLDEPTH_32F: \
-        LQR_TRY_N_N ((dest) = LRQ_CALLOC (lqr_t_32f, (size))); \
+        LQR_TRY_N_N ((dest) = LQR_CARVER_CALLOC ((r), lqr_t_32f, (size))); \
         break; \
       case LQR_COLDEPTH_64F: \
-        LQR_TRY_N_N ((dest) = LRQ_CALLOC (lqr_t_64f, (size))); \
+        LQR_TRY_N_N ((dest) = LQR_CARVER_CALLOC ((r), lqr_t_64f, (size))); \
         break; \
     } \
 } while(0)
 
-#define BUF_TRY_NEW0_RET_POINTER(dest, size, col_depth) do { \
+#define BUF_TRY_NEW0_RET_LQR(r, dest, size, col_depth) do { \
   switch (col_depth) \
     { \
       case LQR_COLDEPTH_8I: \
-        LQR_TRY_N_N ((dest) = LRQ_CALLOC (lqr_t_8i, (size))); \
+        LQR_CATCH_MEM ((dest) = LQR_CARVER_CALLOC ((r), lqr_t_8i, (size))); \
         break; \
       case LQR_COLDEPTH_16I: \
-        LQR_TRY_N_N ((dest) = LRQ_CALLOC (lqr_t_16i, (size))); \
+        LQR_CATCH_MEM ((dest) = LQR_CARVER_CALLOC ((r), lqr_t_16i, (size))); \
         break; \
       case LQR_COLDEPTH_32F: \
-        LQR_TRY_N_N ((dest) = LRQ_CALLOC (lqr_t_32f, (size))); \
+        LQR_CATCH_MEM ((dest) = LQR_CARVER_CALLOC ((r), lqr_t_32f, (size))); \
         break; \
       case LQR_COLDEPTH_64F: \
-        LQR_TRY_N_N ((dest) = LRQ_CALLOC (lqr_t_64f, (size))); \
+        LQR_CATCH_MEM ((dest) = LQR_CARVER_CALLOC ((r), lqr_t_64f, (size))); \
         break; \
     } \
 } while(0)
 
-#define BUF_TRY_NEW0_RET_LQR(dest, size, col_depth) do { \
+/* maps which are reused (and grown when needed) across the
+ * reallocations of the carver, see lqr_mem_reserve; the
+ * contents are undefined unless the 0 version is used */
+#define LQR_CARVER_RESERVE(r, ptr, type, count) \
+    ((type *) lqr_carver_reserve((r), (ptr), (count), sizeof(type), false))
+#define LQR_CARVER_RESERVE0(r, ptr, type, count) \
+    ((type *) lqr_carver_reserve((r), (ptr), (count), sizeof(type), true))
+
+/* make a map private to the carver before modifying it in place,
+ * if it is shared with a clone (NULL maps are skipped); on failure
+ * the map is left untouched */
+#define LQR_CARVER_UNSHARE_RET_LQR(r, map) do { \
+  void *buf_ = (map); \
+  if (buf_ != NULL) \
+    { \
+      LQR_CATCH_MEM (buf_ = lqr_carver_unshare ((r), buf_)); \
+      (map) = buf_; \
+    } \
+} while(0)
+
+/* reserve an image buffer from a spare one, which is consumed
+ * (dest and spare may be the same) */
+#define BUF_TRY_RESERVE_RET_LQR(r, dest, spare, size, col_depth) do { \
+  void *buf_ = NULL; \
   switch (col_depth) \
     { \
       case LQR_COLDEPTH_8I: \
-        LQR_CATCH_MEM ((dest) = LRQ_CALLOC (lqr_t_8i, (size))); \
+        buf_ = LQR_CARVER_RESERVE ((r), (spare), lqr_t_8i, (size)); \
         break; \
       case LQR_COLDEPTH_16I: \
-        LQR_CATCH_MEM ((dest) = LRQ_CALLOC (lqr_t_16i, (size))); \
+        buf_ = LQR_CARVER_RESERVE ((r), (spare), lqr_t_16i, (size)); \
         break; \
       case LQR_COLDEPTH_32F: \
-        LQR_CATCH_MEM ((dest) = LRQ_CALLOC (lqr_t_32f, (size))); \
+        buf_ = LQR_CARVER_RESERVE ((r), (spare), lqr_t_32f, (size)); \
         break; \
       case LQR_COLDEPTH_64F: \
-        LQR_CATCH_MEM ((dest) = LRQ_CALLOC (lqr_t_64f, (size))); \
+        buf_ = LQR_CARVER_RESERVE ((r), (spare), lqr_t_64f, (size)); \
         break; \
     } \
+  (spare) = NULL; \
+  LQR_CATCH_MEM ((dest) = buf_); \
 } while(0)
 
 #define LQR_CATCH_CANC(carver) do { \
@@ -175,9 +253,65 @@
     } \
 } while(0)
 
+/* polled once per row by the functions which build a map of their
+ * own (e.g. the brightness cache): if cancelled, the partial map
+ * is freed and NULL is returned */
+#define LQR_CATCH_CANC_ROW_N(carver, buffer) do { \
+  if (atomic_load(&((carver)->state)) == LQR_CARVER_STATE_CANCELLED) \
+    { \
+      LRQ_FREE (buffer); \
+      return NULL; \
+    } \
+} while(0)
+
 /* Tolerance for update_mmap */
 #define UPDATE_TOLERANCE (1e-5)
 
+/* Index of the point (x, y) in the energy related maps (en, m, least
+ * and rcache): with the compact layout these are packed row by row in
+ * the order of the visible columns, otherwise they are addressed
+ * through the raw indirection like all other maps;
+ * since carving may move the beginning of the raw rows, the
+ * compact rows follow them (LQR_MAP_ROW is the offset of row y) */
+#define LQR_MAP_ROW(r, y) ((int) ((r)->raw[(y)] - (r)->_raw))
+#define LQR_MAP_INDEX(r, x, y) ((r)->compact ? LQR_MAP_ROW(r, y) + (x) : (r)->raw[(y)][(x)])
+
+/* Marks the column offsets in least_dx whose target was carved out */
+#define LQR_LEAST_DX_NONE (INT8_MIN)
+
+/* Minimum number of columns per thread in the threaded minpath map computation */
+#define LQR_MMAP_MIN_CHUNK (256)
+
+/* Side of the square tiles in which the maps are transposed */
+#define LQR_TRANSPOSE_TILE (32)
+
+/* Transposes the tile [x_min, x_max) x [y_min, y_max) of the src map
+ * into dest (row length dest_w), moving pixels of size bytes; the src
+ * map has row length src_w, unless idx is not NULL: then it holds the
+ * src indices of the tile rows, starting from y_min, in rows of length
+ * src_w; size should be a constant so that the copy gets inlined */
+#define TRANSPOSE_TILE(dest, src, idx, src_w, dest_w, x_min, x_max, y_min, y_max, size) do { \
+  int tx_, ty_; \
+  for (tx_ = (x_min); tx_ < (x_max); tx_++) { \
+      unsigned char *d_ = (unsigned char *) (dest) + ((size_t) tx_ * (dest_w) + (y_min)) * (size); \
+      if (idx) { \
+          const int *i_ = (idx) + tx_; \
+          for (ty_ = (y_min); ty_ < (y_max); ty_++) { \
+              memcpy(d_, (const unsigned char *) (src) + (size_t) *i_ * (size), (size)); \
+              d_ += (size); \
+              i_ += (src_w); \
+          } \
+      } else { \
+          const unsigned char *s_ = (const unsigned char *) (src) + ((size_t) (y_min) * (src_w) + tx_) * (size); \
+          for (ty_ = (y_min); ty_ < (y_max); ty_++) { \
+              memcpy(d_, s_, (size)); \
+              d_ += (size); \
+              s_ += (size_t) (src_w) * (size); \
+          } \
+      } \
+  } \
+} while(0)
+
 /* Carver states */
 
 enum _LqrCarverState {
@@ -191,6 +325,25 @@ enum _LqrCarverState {
 
 typedef enum _LqrCarverState LqrCarverState;
 
+/* Energy map computation job (one reading window per thread) */
+
+struct _LqrEmapJob {
+    LqrCarver *r;                       /* the carver */
+    LqrReadingWindow **rwindows;        /* reading windows, one per thread */
+    LqrRetVal *ret;                     /* return values, one per thread */
+};
+
+typedef struct _LqrEmapJob LqrEmapJob;
+
+/* Minpath map computation job (rows are split in column chunks) */
+
+struct _LqrMmapJob {
+    LqrCarver *r;                       /* the carver */
+    atomic_int cancel_row;              /* row at which the computation was cancelled */
+};
+
+typedef struct _LqrMmapJob LqrMmapJob;
+
 /**** LQR_CARVER CLASS DEFINITION ****/
 
 /* This is the representation of the multisize image */
@@ -230,15 +383,24 @@ struct _LqrCarver {
 
     void *rgb;                          /* array of rgb points */
     int *vs;                           /* array of visibility levels */
+    unsigned int vs_serial;             /* changed when the visibility map is rewritten
+                                         * (lets the cursors know their bitmaps are stale) */
     float *en;                         /* array of energy levels */
     float *bias;                       /* bias mask */
     float *m;                          /* array of auxiliary energy values */
     int *least;                        /* array of pointers */
+    int8_t *least_dx;                  /* array of pointers as column offsets (compact layout) */
     int *_raw;                         /* array of array-coordinates, for seam computation */
     int **raw;                         /* array of array-coordinates, for seam computation */
 
+    void *rgb_spare;                    /* released maps, reused by the next */
+    int *vs_spare;                     /* flatten, transpose or inflate */
+    float *bias_spare;
+    float *rigmask_spare;
+
     LqrCursor *c;                       /* cursor to be used as image reader */
     void *rgb_ro_buffer;                /* readout buffer */
+    LqrSpan *spans;                     /* spans readout buffer */
 
     int *vpath;                        /* array of array-coordinates representing a vertical seam */
     int *vpath_x;                      /* array of abscisses representing a vertical seam */
@@ -260,19 +422,42 @@ struct _LqrCarver {
 
     int *nrg_xmin;                     /* auxiliary vector for energy update */
     int *nrg_xmax;                     /* auxiliary vector for energy update */
+    int *carved_xmin;                  /* leftmost seam carved since the last energy update (by row) */
+    int *carved_xmax;                  /* rightmost seam carved since the last energy update (by row) */
 
     bool nrg_uptodate;              /* flag set if energy map is up to date */
 
+    int n_threads;                     /* number of threads used for maps computation */
+    LqrThreadPool *pool;                /* worker threads (NULL if n_threads is 1) */
+
+    int seams_per_pass;                /* seams extracted from each minpath map (1 = exact) */
+    int pyramid_factor;                /* downsampling factor for the seam search (1 = off) */
+    int pyramid_band;                  /* half width of the refinement band (0 = default) */
+    LqrCarverPyramid pyramid;          /* guidance of the running search */
+
+    LqrCarverDual dual;                 /* maps kept for both orientations */
+
     double *rcache;                    /* array of brightness (or luma or else) levels for energy computation */
     bool use_rcache;                /* wheter to cache brightness, luma etc. */
 
+    bool compact;                   /* whether the energy related maps use the compact layout */
+    LqrKernels kernels;                 /* kernels selected at creation */
+    LqrMinpathRowFunc minpath_row;      /* minpath kernel for the compact layout */
+
     LqrVMapList *flushed_vs;            /* linked list of pointers to flushed visibility maps buffers */
 
+#ifdef LQR_ENABLE_STATS
+    LqrStats stats;                     /* timings and counters */
+#endif /* LQR_ENABLE_STATS */
+
     bool preserve_in_buffer;        /* whether to preserve the buffer given to lqr_carver_new */
+    bool rgb_user;                  /* whether rgb is the buffer given to lqr_carver_new */
+    unsigned int rgb_serial;            /* incremented whenever rgb is replaced */
+
+    LqrMemAccount mem;                  /* memory used by the maps */
 
     atomic_int state;                /* current state of the carver (actually a LqrCarverState enum) */
-    atomic_int state_lock;           /* lock for state changing routines */
-    atomic_int state_lock_queue;     /* lock queue for state changing routines */
+    pthread_mutex_t state_lock;         /* serializes the state changing routines */
 
 };
 
@@ -283,19 +468,42 @@ LqrCarver *lqr_carver_new_common(int width, int height, int channels);
 
 /* Init energy related structures only */
 LqrRetVal lqr_carver_init_energy_related(LqrCarver *r);
+LqrRetVal lqr_carver_alloc_least(LqrCarver *r, int size);
+void lqr_carver_rigidity_map_fill(LqrCarver *r);
+void lqr_carver_rgb_free(LqrCarver *r);
+void lqr_carver_rgb_replace(LqrCarver *r, void *rgb);
+void *lqr_carver_reserve(LqrCarver *r, void *ptr, size_t count, size_t size, bool zero);
+void lqr_carver_maps_spare(LqrCarver *r, void *rgb, int *vs, float *bias, float *rigmask);
+void *lqr_carver_unshare(LqrCarver *r, void *ptr);
+LqrRetVal lqr_carver_unshare_vsmap(LqrCarver *r);
+LqrRetVal lqr_carver_clone_maps(LqrCarver *r, LqrCarver *src);
 
 /* build maps */
 LqrRetVal lqr_carver_build_maps(LqrCarver *r, int depth);      /* build all */
 LqrRetVal lqr_carver_build_emap(LqrCarver *r);  /* energy */
+LqrRetVal lqr_carver_build_emap_rows(LqrCarver *r, LqrReadingWindow *rwindow, int y_start, int y_end);
+LqrRetVal lqr_carver_build_emap_threaded(LqrCarver *r);
+void lqr_carver_build_emap_worker(void *data, int thread_index, int n_threads);
 LqrRetVal lqr_carver_build_mmap(LqrCarver *r);  /* minpath */
+void lqr_carver_build_mmap_row(LqrCarver *r, int y, int x_start, int x_end);
+void lqr_carver_build_mmap_row_compact(LqrCarver *r, int y, int x_start, int x_end);
+void lqr_carver_minpath_row_setup(LqrCarver *r, LqrMinpathRow *row, int y, float *m, int8_t *least);
+LqrRetVal lqr_carver_build_mmap_threaded(LqrCarver *r);
+void lqr_carver_build_mmap_worker(void *data, int thread_index, int n_threads);
 LqrRetVal lqr_carver_build_vsmap(LqrCarver *r, int depth);     /* visibility */
 
 /* internal functions for maps computation */
-LqrRetVal lqr_carver_compute_e(LqrCarver *r, int x, int y);   /* compute energy of point at c */
+LqrRetVal lqr_carver_compute_e(LqrCarver *r, LqrReadingWindow *rwindow, int x, int y);       /* compute energy of point at c */
+LqrRetVal lqr_carver_compute_e_row(LqrCarver *r, LqrReadingWindow *rwindow, int y, int x_start, int x_end);
 LqrRetVal lqr_carver_update_emap(LqrCarver *r); /* update energy map after seam removal */
 LqrRetVal lqr_carver_update_mmap(LqrCarver *r); /* minpath */
 void lqr_carver_build_vpath(LqrCarver *r);      /* compute seam path */
+void lqr_carver_build_vpath_approx(LqrCarver *r);       /* compute seam path from a stale minpath map */
 void lqr_carver_carve(LqrCarver *r);    /* updates the "raw" buffer */
+void lqr_carver_move_maps_compact(LqrCarver *r, int z_dest, int z_src, int n);
+void lqr_carver_carve_least_dx(LqrCarver *r, int y);
+void lqr_carver_update_carved_range(LqrCarver *r, bool first);
+void lqr_carver_reset_raw_rows(LqrCarver *r);
 void lqr_carver_update_vsmap(LqrCarver *r, int l);     /* update visibility map after seam removal */
 void lqr_carver_finish_vsmap(LqrCarver *r);     /* complete visibility map (last seam) */
 LqrRetVal lqr_carver_inflate(LqrCarver *r, int l);     /* adds enlargment info to map */
@@ -304,9 +512,17 @@ LqrRetVal lqr_carver_propagate_vsmap(LqrCarver *r);     /* propagates vsmap on a
 /* image manipulations */
 LqrRetVal lqr_carver_resize_width(LqrCarver *r, int w1);       /* liquid resize width */
 LqrRetVal lqr_carver_resize_height(LqrCarver *r, int h1);      /* liquid resize height */
+LqrRetVal lqr_carver_resize_ordered(LqrCarver *r, int w1, int h1);     /* both, in the resize order */
 void lqr_carver_set_width(LqrCarver *r, int w1);
 LqrRetVal lqr_carver_transpose(LqrCarver *r);
+void lqr_carver_transpose_tile(void *dest, const void *src, const int *idx, int src_w, int dest_w, int x_min, int x_max,
+                               int y_min, int y_max, size_t pxl_size);
 void lqr_carver_scan_reset_all(LqrCarver *r);
+LqrRetVal lqr_carver_export_cursor(LqrCarver *r, LqrCursor *c, int x, int y, int width, int height, void *dest,
+                                   size_t row_stride, LqrColDepth col_depth, const int *channel_order);
+void lqr_carver_copy_line(LqrCarver *r, LqrCursor *c, int y, int width, void *dest);
+void lqr_carver_export_pixels(LqrCarver *r, void *dest, const int *idx, int idx_step, int n, LqrColDepth col_depth,
+                              const int *channel_order);
 
 /* auxiliary */
 LqrRetVal lqr_carver_scan_reset_attached(LqrCarver *r, LqrDataTok data);
@@ -59,12 +59,28 @@
 #error "lqr_progress_pub.h must be included prior to lqr_carver_pub.h"
 #endif /* __LQR_PROGRESS_PUB_H__ */
 
+/* A run of contiguous visible pixels of a line, read in place
+ * from the carver's image buffer */
+struct _LqrSpan {
+    void *rgb;                          /* first pixel (of the carver's colour depth) */
+    int x;                              /* position of the first pixel along the line */
+    int length;                         /* number of pixels */
+};
+
+typedef struct _LqrSpan LqrSpan;
+
 /* LQR_CARVER CLASS PUBLIC FUNCTIONS */
 
 /* constructor & destructor */
 LQR_PUBLIC LqrCarver *lqr_carver_new(uint8_t *buffer, int width, int height, int channels);
 LQR_PUBLIC LqrCarver *lqr_carver_new_ext(void *buffer, int width, int height, int channels,
                                          LqrColDepth colour_depth);
+/* lqr_carver_reset takes ownership of buffer, as lqr_carver_new does
+ * (the caller must not free it), and drops the bias, rigidity mask,
+ * brightness cache, dumped visibility maps, multi-resolution search
+ * state and dual cache of the previous image */
+LQR_PUBLIC LqrRetVal lqr_carver_reset(LqrCarver *r, void *buffer, int width, int height);
+LQR_PUBLIC LqrCarver *lqr_carver_clone(LqrCarver *r);
 LQR_PUBLIC void lqr_carver_destroy(LqrCarver *r);
 
 /* initialize */
@@ -83,6 +99,9 @@ LQR_PUBLIC void lqr_carver_set_use_cache(LqrCarver *r, bool use_cache);
 LQR_PUBLIC LqrRetVal lqr_carver_attach(LqrCarver *r, LqrCarver *aux);
 LQR_PUBLIC void lqr_carver_set_progress(LqrCarver *r, LqrProgress * p);
 LQR_PUBLIC void lqr_carver_set_preserve_input_image(LqrCarver *r);
+LQR_PUBLIC LqrRetVal lqr_carver_set_n_threads(LqrCarver *r, int n_threads);
+LQR_PUBLIC LqrRetVal lqr_carver_set_compact_layout(LqrCarver *r, bool compact);
+LQR_PUBLIC LqrRetVal lqr_carver_set_seams_per_pass(LqrCarver *r, int seams_per_pass);
 /* THIS FUNCTION IS ONLY MAINTAINED FOR BACK-COMPATIBILITY PURPOSES */
 /* lqr_carver_set_energy_function_builtin() should be used instead */
 LRQ_DEPRECATED
@@ -99,6 +118,15 @@ LQR_PUBLIC bool lqr_carver_scan(LqrCarver *r, int *x, int *y, uint8_t **rgb);
 LQR_PUBLIC bool lqr_carver_scan_ext(LqrCarver *r, int *x, int *y, void **rgb);
 LQR_PUBLIC bool lqr_carver_scan_line(LqrCarver *r, int *n, uint8_t **rgb);
 LQR_PUBLIC bool lqr_carver_scan_line_ext(LqrCarver *r, int *n, void **rgb);
+LQR_PUBLIC bool lqr_carver_scan_spans(LqrCarver *r, int *n, LqrSpan **spans, int *n_spans);
+LQR_PUBLIC LqrRetVal lqr_carver_export(LqrCarver *r, void *dest, size_t row_stride, LqrColDepth col_depth,
+                                       const int *channel_order);
+LQR_PUBLIC LqrRetVal lqr_carver_export_region(LqrCarver *r, int x, int y, int width, int height, void *dest,
+                                              size_t row_stride, LqrColDepth col_depth, const int *channel_order);
+LQR_PUBLIC LqrRetVal lqr_carver_export_widths(LqrCarver *r, int n_widths, const int *widths, void **dest,
+                                              const size_t *row_strides, LqrColDepth col_depth,
+                                              const int *channel_order);
+LQR_PUBLIC bool lqr_carver_get_pixel(LqrCarver *r, int x, int y, void **rgb);
 LQR_PUBLIC bool lqr_carver_scan_by_row(LqrCarver *r);
 LRQ_DEPRECATED
 LQR_PUBLIC int lqr_carver_get_bpp(LqrCarver *r);
@@ -112,5 +140,7 @@ LQR_PUBLIC LqrColDepth lqr_carver_get_col_depth(LqrCarver *r);
 LQR_PUBLIC LqrImageType lqr_carver_get_image_type(LqrCarver *r);
 LQR_PUBLIC float lqr_carver_get_enl_step(LqrCarver *r);
 LQR_PUBLIC int lqr_carver_get_depth(LqrCarver *r);
+LQR_PUBLIC int lqr_carver_get_n_threads(LqrCarver *r);
+LQR_PUBLIC int lqr_carver_get_seams_per_pass(LqrCarver *r);
 
 #endif /* __LQR_CARVER_PUB_H__ */
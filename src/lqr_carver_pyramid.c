@@ -0,0 +1,356 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "lqr_all.h"
+
+#ifdef __LQR_DEBUG__
+#include <assert.h>
+#endif /* __LQR_DEBUG__ */
+
+/**** LQR_CARVER_PYRAMID STRUCT FUNCTIONS ****/
+
+/* set the multi-resolution seam search: the seams are first
+ * computed on a copy of the image downsampled by the given
+ * factor, then refined at full resolution within a band of
+ * the given half width around them (0 = twice the factor);
+ * a factor of 1 disables it */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_pyramid(LqrCarver *r, int factor, int band)
+{
+    LQR_CATCH_F(factor >= 1);
+    LQR_CATCH_F(band >= 0);
+    LQR_CATCH_F(r->root == NULL);
+    LQR_CATCH_CANC(r);
+    LQR_CATCH_F(atomic_load(&r->state) == LQR_CARVER_STATE_STD);
+
+    r->pyramid_factor = factor;
+    r->pyramid_band = band;
+
+    return LQR_OK;
+}
+
+/* prepare the guidance for the next n_fine seams of the carver;
+ * if the search is disabled or the image is too small to be
+ * downsampled no guidance is given (n_seams is set to 0) */
+LqrRetVal
+lqr_carver_pyramid_init(LqrCarver *r, LqrCarverPyramid *p, int n_fine)
+{
+    LqrCarver *c;
+    LqrRetVal ret_val;
+    int w = r->w / r->pyramid_factor;
+    int h = r->h / r->pyramid_factor;
+
+    /* drop the leftovers of an interrupted search */
+    lqr_carver_pyramid_clear(p);
+
+    p->w = w;
+    p->h = h;
+    p->w_fine = r->w;
+    p->band = r->pyramid_band ? r->pyramid_band : 2 * r->pyramid_factor;
+    p->band = MAX(p->band, r->delta_x);
+
+    if ((r->pyramid_factor <= 1) || (w < 3) || (h < 2) || (n_fine < 1)) {
+        return LQR_OK;
+    }
+
+    /* coarse seams needed to cover the fine ones */
+    p->n_seams = MIN((int) ((double) (n_fine - 1) * w / p->w_fine) + 1, w - 2);
+
+    LQR_CATCH_MEM(p->seams_x = LQR_CARVER_CALLOC(r, int, p->n_seams * h));
+    LQR_CATCH_MEM(p->band_min = LQR_CARVER_CALLOC(r, int, r->h));
+    LQR_CATCH_MEM(p->band_max = LQR_CARVER_CALLOC(r, int, r->h));
+    LQR_CATCH_MEM(p->m = LQR_CARVER_CALLOC(r, float, r->h * (2 * p->band + 1)));
+    LQR_CATCH_MEM(p->least = LQR_CARVER_CALLOC(r, int, r->h * (2 * p->band + 1)));
+
+    LQR_CATCH_MEM(c = lqr_carver_pyramid_coarse_new(r, w, h));
+    ret_val = lqr_carver_pyramid_coarse_seams(r, c, p->n_seams, p->seams_x);
+    LQR_STATS_MERGE(r, c);
+    lqr_carver_destroy(c);
+
+    return ret_val;
+}
+
+void
+lqr_carver_pyramid_clear(LqrCarverPyramid *p)
+{
+    LRQ_FREE(p->seams_x);
+    LRQ_FREE(p->band_min);
+    LRQ_FREE(p->band_max);
+    LRQ_FREE(p->m);
+    LRQ_FREE(p->least);
+    p->n_seams = 0;
+}
+
+/* create a carver for the current image downsampled to w x h
+ * (box filtered), with the same energy and seam settings;
+ * bias and rigidity masks are downsampled as well */
+LqrCarver *
+lqr_carver_pyramid_coarse_new(LqrCarver *r, int w, int h)
+{
+    LqrCarver *c;
+    double *buffer;
+    double *bias = NULL;
+    double *rigmask = NULL;
+    int x, y, k;
+    int x1, y1, x1_min, x1_max, y1_min, y1_max;
+    int data, n, z0;
+
+    buffer = LQR_CARVER_CALLOC(r, double, w * h * r->channels);
+    if (r->bias) {
+        bias = LQR_CARVER_CALLOC(r, double, w * h);
+    }
+    if (r->rigidity_mask) {
+        rigmask = LQR_CARVER_CALLOC(r, double, w * h);
+    }
+    if ((buffer == NULL) || (r->bias && (bias == NULL)) || (r->rigidity_mask && (rigmask == NULL))) {
+        LRQ_FREE(buffer);
+        LRQ_FREE(bias);
+        LRQ_FREE(rigmask);
+        return NULL;
+    }
+
+    for (y = 0; y < h; y++) {
+        y1_min = y * r->h / h;
+        y1_max = (y + 1) * r->h / h;
+        for (x = 0; x < w; x++) {
+            x1_min = x * r->w / w;
+            x1_max = (x + 1) * r->w / w;
+            z0 = y * w + x;
+            for (y1 = y1_min; y1 < y1_max; y1++) {
+                for (x1 = x1_min; x1 < x1_max; x1++) {
+                    data = r->raw[y1][x1];
+                    for (k = 0; k < r->channels; k++) {
+                        buffer[z0 * r->channels + k] += lqr_pixel_get_norm(r->rgb, data * r->channels + k,
+                                                                           r->col_depth);
+                    }
+                    if (bias) {
+                        bias[z0] += r->bias[data];
+                    }
+                    if (rigmask) {
+                        rigmask[z0] += r->rigidity_mask[data];
+                    }
+                }
+            }
+            n = (y1_max - y1_min) * (x1_max - x1_min);
+            for (k = 0; k < r->channels; k++) {
+                buffer[z0 * r->channels + k] /= n;
+            }
+            if (bias) {
+                bias[z0] /= n;
+            }
+            if (rigmask) {
+                rigmask[z0] /= n;
+            }
+        }
+    }
+
+    c = lqr_carver_new_ext(buffer, w, h, r->channels, LQR_COLDEPTH_64F);
+    if (c == NULL) {
+        LRQ_FREE(buffer);
+    } else {
+        /* the buffer comes from the library allocator, not from the user */
+        c->rgb_user = false;
+        c->image_type = r->image_type;
+        c->alpha_channel = r->alpha_channel;
+        c->black_channel = r->black_channel;
+        c->use_rcache = r->use_rcache;
+        c->leftright = r->leftright;
+        if ((lqr_carver_set_energy_function(c, r->nrg, r->nrg_radius, r->nrg_read_t, r->nrg_extra_data) != LQR_OK)
+            || (lqr_carver_init(c, r->delta_x, r->rigidity) != LQR_OK)
+            || (bias && ((c->bias = LQR_CARVER_CALLOC(c, float, w * h)) == NULL))
+            || (rigmask && ((c->rigidity_mask = LQR_CARVER_CALLOC(c, float, w * h)) == NULL))) {
+            lqr_carver_destroy(c);
+            c = NULL;
+        }
+    }
+
+    /* the bias enters the energy divided by the width */
+    if (c && bias) {
+        for (z0 = 0; z0 < w * h; z0++) {
+            c->bias[z0] = (float) (bias[z0] * w / r->w_start);
+        }
+    }
+    if (c && rigmask) {
+        for (z0 = 0; z0 < w * h; z0++) {
+            c->rigidity_mask[z0] = (float) rigmask[z0];
+        }
+    }
+    LRQ_FREE(bias);
+    LRQ_FREE(rigmask);
+
+    return c;
+}
+
+/* carve n_seams seams from the coarse carver c, recording them
+ * (the cancellation is checked on the full resolution carver r) */
+LqrRetVal
+lqr_carver_pyramid_coarse_seams(LqrCarver *r, LqrCarver *c, int n_seams, int *seams_x)
+{
+    int l;
+
+    LQR_CATCH(lqr_carver_build_emap(c));
+    LQR_CATCH(lqr_carver_build_mmap(c));
+
+    for (l = 0; l < n_seams; l++) {
+        LQR_CATCH_CANC(r);
+
+        lqr_carver_build_vpath(c);
+        memcpy(seams_x + l * c->h, c->vpath_x, c->h * sizeof(int));
+
+        lqr_carver_update_vsmap(c, l + 1);
+        c->level++;
+        c->w--;
+        lqr_carver_carve(c);
+        lqr_carver_update_carved_range(c, true);
+
+        LQR_CATCH(lqr_carver_update_emap(c));
+        LQR_CATCH(lqr_carver_update_mmap(c));
+    }
+
+    return LQR_OK;
+}
+
+/* compute the i-th guided seam path (counting from the
+ * initialization): the minpath is computed only within a band
+ * around the projection of the corresponding coarse seam;
+ * returns false if there's no guidance for this seam or if
+ * the band contains no connected path */
+bool
+lqr_carver_pyramid_build_vpath(LqrCarver *r, LqrCarverPyramid *p, int i)
+{
+    int x, y, x1;
+    int x1_min, x1_max;
+    int y0, ic, w_coarse;
+    int dx, stride;
+    float *m_row, *m_down;
+    int *least_row;
+    float m, m1, r_fact;
+    double yc, t, xc, center;
+    int last_x = -1;
+
+    LQR_STATS_TIMER(t0);
+
+    ic = (int) ((double) i * p->w / p->w_fine);
+    if (ic >= p->n_seams) {
+        return false;
+    }
+    /* width of the coarse image when the seam was carved */
+    w_coarse = p->w - ic;
+    stride = 2 * p->band + 1;
+
+    /* project the coarse seam (interpolating between the rows) */
+    for (y = 0; y < r->h; y++) {
+        yc = (y + 0.5) * p->h / r->h - 0.5;
+        yc = MAX(yc, 0);
+        y0 = MIN((int) yc, p->h - 1);
+        t = yc - y0;
+        xc = p->seams_x[ic * p->h + y0];
+        if (y0 < p->h - 1) {
+            xc += t * (p->seams_x[ic * p->h + y0 + 1] - xc);
+        }
+        center = (xc + 0.5) * r->w / w_coarse - 0.5;
+        x = (int) floor(center + 0.5);
+        p->band_min[y] = MAX(MIN(x - p->band, r->w - 1), 0);
+        p->band_max[y] = MAX(MIN(x + p->band, r->w - 1), 0);
+    }
+
+    /* minpath within the band (FLT_MAX marks unreachable points);
+     * the band rows are stored starting from their first column */
+    r_fact = 1;
+    m_row = p->m;
+    for (x = p->band_min[0]; x <= p->band_max[0]; x++) {
+        m_row[x - p->band_min[0]] = r->en[LQR_MAP_INDEX(r, x, 0)];
+    }
+    for (y = 1; y < r->h; y++) {
+        m_down = m_row;
+        m_row = p->m + y * stride;
+        least_row = p->least + y * stride;
+        LQR_STATS_COUNT(r, mmap_cells, p->band_max[y] - p->band_min[y] + 1);
+        for (x = p->band_min[y]; x <= p->band_max[y]; x++) {
+            if (r->rigidity_mask) {
+                r_fact = r->rigidity_mask[r->raw[y][x]];
+            }
+            x1_min = MAX(x - r->delta_x, p->band_min[y - 1]);
+            x1_max = MIN(x + r->delta_x, p->band_max[y - 1]);
+            m = FLT_MAX;
+            dx = 0;
+            for (x1 = x1_min; x1 <= x1_max; x1++) {
+                m1 = m_down[x1 - p->band_min[y - 1]];
+                if (m1 == FLT_MAX) {
+                    continue;
+                }
+                if (r->rigidity) {
+                    m1 += r_fact * r->rigidity_map[x1 - x];
+                }
+                if ((m1 < m) || ((m1 == m) && (r->leftright == 1))) {
+                    m = m1;
+                    dx = x1 - x;
+                }
+            }
+            m_row[x - p->band_min[y]] = (m == FLT_MAX) ? FLT_MAX : r->en[LQR_MAP_INDEX(r, x, y)] + m;
+            least_row[x - p->band_min[y]] = dx;
+        }
+    }
+
+    /* span the last row of the band for the minimum */
+    y = r->h - 1;
+    m = FLT_MAX;
+    for (x = p->band_min[y]; x <= p->band_max[y]; x++) {
+        m1 = m_row[x - p->band_min[y]];
+        if ((m1 < m) || ((m1 == m) && (m1 != FLT_MAX) && (r->leftright == 1))) {
+            m = m1;
+            last_x = x;
+        }
+    }
+    if (last_x < 0) {
+        return false;
+    }
+
+    /* backtrack */
+    for (y = r->h - 1; y >= 0; y--) {
+        r->vpath[y] = r->raw[y][last_x];
+        r->vpath_x[y] = last_x;
+        if (y > 0) {
+            last_x += p->least[y * stride + last_x - p->band_min[y]];
+        }
+    }
+
+#ifdef __LQR_DEBUG__
+    for (y = 0; y < r->h; y++) {
+        assert(r->vs[r->vpath[y]] == 0);
+    }
+#endif /* __LQR_DEBUG__ */
+
+    LQR_STATS_PHASE(r, LQR_STATS_BUILD_VPATH, t0);
+    return true;
+}
+
+/**** END OF LQR_CARVER_PYRAMID CLASS FUNCTIONS ****/
@@ -0,0 +1,59 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_CARVER_PYRAMID_PRIV_H__
+#define __LQR_CARVER_PYRAMID_PRIV_H__
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_carver_pyramid_priv.h"
+#endif /* __LQR_BASE_H__ */
+
+/**** LQR_CARVER_PYRAMID STRUCT DEFINITION ****/
+
+/* The seams of a downsampled copy of the image, used to guide the
+ * search of the full resolution seams: each of these is searched
+ * only inside a band of columns around a projected coarse seam */
+struct _LqrCarverPyramid {
+    int w;                              /* coarse image width */
+    int h;                              /* coarse image height */
+    int w_fine;                         /* width of the image the coarse one was made from */
+    int n_seams;                        /* number of coarse seams (0 = no guidance) */
+    int *seams_x;                       /* abscissae of the coarse seams, h per seam,
+                                         * each in the coordinates it was carved from */
+    int band;                           /* half width of the search band */
+    int *band_min;                      /* first column of the band (by row) */
+    int *band_max;                      /* last column of the band (by row) */
+    float *m;                           /* minpath values within the band */
+    int *least;                         /* predecessors within the band (column offsets) */
+};
+
+typedef struct _LqrCarverPyramid LqrCarverPyramid;
+
+/* LQR_CARVER_PYRAMID PRIVATE FUNCTIONS */
+
+LqrRetVal lqr_carver_pyramid_init(LqrCarver *r, LqrCarverPyramid *p, int n_fine);
+void lqr_carver_pyramid_clear(LqrCarverPyramid *p);
+LqrCarver *lqr_carver_pyramid_coarse_new(LqrCarver *r, int w, int h);
+LqrRetVal lqr_carver_pyramid_coarse_seams(LqrCarver *r, LqrCarver *c, int n_seams, int *seams_x);
+bool lqr_carver_pyramid_build_vpath(LqrCarver *r, LqrCarverPyramid *p, int i);
+
+#endif /* __LQR_CARVER_PYRAMID_PRIV_H__ */
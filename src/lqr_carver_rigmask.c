@@ -49,7 +49,7 @@ lqr_carver_rigmask_init(LqrCarver *r)
 
     LQR_CATCH_F(r->active);
 
-    LQR_CATCH_MEM(r->rigidity_mask = LRQ_CALLOC(float, r->w0 * r->h0));
+    LQR_CATCH_MEM(r->rigidity_mask = LQR_CARVER_CALLOC(r, float, r->w0 * r->h0));
 
 #if 0
     for (y = 0; y < r->h0; y++) {
@@ -79,6 +79,7 @@ lqr_carver_rigmask_add_xy(LqrCarver *r, double rigidity, int x, int y)
     if (r->rigidity_mask == NULL) {
         LQR_CATCH(lqr_carver_rigmask_init(r));
     }
+    LQR_CARVER_UNSHARE_RET_LQR(r, r->rigidity_mask);
 #if 0
     if (r->rigidity == 0) {
         return LQR_OK;
@@ -118,6 +119,7 @@ lqr_carver_rigmask_add_area(LqrCarver *r, double *buffer, int width, int height,
     if (r->rigidity_mask == NULL) {
         LQR_CATCH(lqr_carver_rigmask_init(r));
     }
+    LQR_CARVER_UNSHARE_RET_LQR(r, r->rigidity_mask);
 
     wt = r->transposed ? r->h : r->w;
     ht = r->transposed ? r->w : r->h;
@@ -178,6 +180,7 @@ lqr_carver_rigmask_add_rgb_area(LqrCarver *r, uint8_t *rgb, int channels, int wi
     if (r->rigidity_mask == NULL) {
         LQR_CATCH(lqr_carver_rigmask_init(r));
     }
+    LQR_CARVER_UNSHARE_RET_LQR(r, r->rigidity_mask);
 
     has_alpha = (channels == 2 || channels >= 4);
     c_channels = channels - (has_alpha ? 1 : 0);
@@ -0,0 +1,176 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "lqr_all.h"
+
+#ifdef __LQR_DEBUG__
+#include <assert.h>
+#endif /* __LQR_DEBUG__ */
+
+/* the kernels in use, shared by all the carvers created afterwards */
+static LqrKernels lqr_cpu_kernels;
+static pthread_mutex_t lqr_cpu_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t lqr_cpu_once = PTHREAD_ONCE_INIT;
+
+/**** LQR_CPU FUNCTIONS ****/
+
+void
+lqr_cpu_init(void)
+{
+    pthread_once(&lqr_cpu_once, lqr_cpu_init_once);
+}
+
+/* the environment variable is only read here; a level
+ * which is not supported by the cpu is ignored */
+void
+lqr_cpu_init_once(void)
+{
+    LqrCpuLevel level = lqr_cpu_detect();
+    LqrCpuLevel env_level;
+    const char *env = getenv(LQR_CPU_LEVEL_ENV);
+
+    if ((env != NULL) && lqr_cpu_level_from_string(env, &env_level)
+        && (env_level != LQR_CPU_LEVEL_AUTO) && (env_level <= level)) {
+        level = env_level;
+    }
+
+    lqr_kernels_select(&lqr_cpu_kernels, level);
+}
+
+LqrCpuLevel
+lqr_cpu_detect(void)
+{
+#ifdef LQR_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return LQR_CPU_LEVEL_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return LQR_CPU_LEVEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return LQR_CPU_LEVEL_SSE42;
+    }
+#endif /* LQR_HAVE_X86_SIMD */
+    return LQR_CPU_LEVEL_SCALAR;
+}
+
+bool
+lqr_cpu_level_from_string(const char *name, LqrCpuLevel *level)
+{
+    if (strcmp(name, "scalar") == 0) {
+        *level = LQR_CPU_LEVEL_SCALAR;
+    } else if (strcmp(name, "sse4.2") == 0) {
+        *level = LQR_CPU_LEVEL_SSE42;
+    } else if (strcmp(name, "avx2") == 0) {
+        *level = LQR_CPU_LEVEL_AVX2;
+    } else if (strcmp(name, "avx512") == 0) {
+        *level = LQR_CPU_LEVEL_AVX512;
+    } else if (strcmp(name, "auto") == 0) {
+        *level = LQR_CPU_LEVEL_AUTO;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* each level falls back on the lower ones
+ * for the kernels it has no specific version of */
+void
+lqr_kernels_select(LqrKernels *kernels, LqrCpuLevel level)
+{
+#ifdef __LQR_DEBUG__
+    assert(level != LQR_CPU_LEVEL_AUTO);
+#endif /* __LQR_DEBUG__ */
+
+    kernels->level = level;
+    kernels->minpath_row_dx1 = lqr_minpath_row_scalar;
+    kernels->grad_row = lqr_grad_row_scalar;
+
+#ifdef LQR_HAVE_X86_SIMD
+    switch (level) {
+        case LQR_CPU_LEVEL_AVX512:
+            kernels->minpath_row_dx1 = lqr_minpath_row_dx1_avx512;
+            kernels->grad_row = lqr_grad_row_avx512;
+            break;
+        case LQR_CPU_LEVEL_AVX2:
+            kernels->minpath_row_dx1 = lqr_minpath_row_dx1_avx2;
+            kernels->grad_row = lqr_grad_row_avx2;
+            break;
+        case LQR_CPU_LEVEL_SSE42:
+            kernels->minpath_row_dx1 = lqr_minpath_row_dx1_sse42;
+            kernels->grad_row = lqr_grad_row_sse42;
+            break;
+        default:
+            break;
+    }
+#endif /* LQR_HAVE_X86_SIMD */
+}
+
+void
+lqr_cpu_get_kernels(LqrKernels *kernels)
+{
+    lqr_cpu_init();
+    pthread_mutex_lock(&lqr_cpu_lock);
+    *kernels = lqr_cpu_kernels;
+    pthread_mutex_unlock(&lqr_cpu_lock);
+}
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_cpu_set_level(LqrCpuLevel level)
+{
+    LqrCpuLevel max_level = lqr_cpu_detect();
+
+    if (level == LQR_CPU_LEVEL_AUTO) {
+        level = max_level;
+    }
+    LQR_CATCH_F(level >= LQR_CPU_LEVEL_SCALAR && level <= max_level);
+
+    lqr_cpu_init();
+    pthread_mutex_lock(&lqr_cpu_lock);
+    lqr_kernels_select(&lqr_cpu_kernels, level);
+    pthread_mutex_unlock(&lqr_cpu_lock);
+
+    return LQR_OK;
+}
+
+/* LQR_PUBLIC */
+LqrCpuLevel
+lqr_cpu_get_level(void)
+{
+    LqrKernels kernels;
+
+    lqr_cpu_get_kernels(&kernels);
+
+    return kernels.level;
+}
+
+/**** END OF LQR_CPU FUNCTIONS ****/
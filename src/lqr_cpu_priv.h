@@ -0,0 +1,75 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_CPU_PRIV_H__
+#define __LQR_CPU_PRIV_H__
+
+#include <pthread.h>
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_cpu_priv.h"
+#endif /* __LQR_BASE_H__ */
+
+#ifndef __LQR_CPU_PUB_H__
+#error "lqr_cpu_pub.h must be included prior to lqr_cpu_priv.h"
+#endif /* __LQR_CPU_PUB_H__ */
+
+#ifndef __LQR_GRADIENT_H__
+#error "lqr_gradient.h must be included prior to lqr_cpu_priv.h"
+#endif /* __LQR_GRADIENT_H__ */
+
+#ifndef __LQR_MINPATH_H__
+#error "lqr_minpath.h must be included prior to lqr_cpu_priv.h"
+#endif /* __LQR_MINPATH_H__ */
+
+/* environment variable used to force the level */
+#define LQR_CPU_LEVEL_ENV "LQR_CPU_LEVEL"
+
+/* Kernels dispatch table */
+
+struct _LqrKernels {
+    LqrCpuLevel level;                  /* level the kernels were selected for */
+    LqrMinpathRowFunc minpath_row_dx1;  /* minpath row for delta_x = 1 */
+    LqrGradRowFunc grad_row;            /* gradient energy row */
+};
+
+typedef struct _LqrKernels LqrKernels;
+
+/* LQR_CPU PRIVATE FUNCTIONS */
+
+/* select the kernels at the first call (later calls do nothing) */
+void lqr_cpu_init(void);
+void lqr_cpu_init_once(void);
+
+/* best level supported by the running cpu */
+LqrCpuLevel lqr_cpu_detect(void);
+
+/* parse a level name, returns false if unknown */
+bool lqr_cpu_level_from_string(const char *name, LqrCpuLevel *level);
+
+/* fill the table with the kernels for the given level */
+void lqr_kernels_select(LqrKernels *kernels, LqrCpuLevel level);
+
+/* copy the current table */
+void lqr_cpu_get_kernels(LqrKernels *kernels);
+
+#endif /* __LQR_CPU_PRIV_H__ */
@@ -0,0 +1,49 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_CPU_PUB_H__
+#define __LQR_CPU_PUB_H__
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_cpu_pub.h"
+#endif /* __LQR_BASE_H__ */
+
+/* Instruction set levels for the internal kernels */
+enum _LqrCpuLevel {
+    LQR_CPU_LEVEL_SCALAR,               /* portable C code only */
+    LQR_CPU_LEVEL_SSE42,                /* SSE up to 4.2 */
+    LQR_CPU_LEVEL_AVX2,                 /* AVX2 */
+    LQR_CPU_LEVEL_AVX512,               /* AVX-512 foundation */
+    LQR_CPU_LEVEL_AUTO                  /* best level supported by the cpu */
+};
+
+typedef enum _LqrCpuLevel LqrCpuLevel;
+
+/* LQR_CPU PUBLIC FUNCTIONS */
+
+/* the level is global and applies to the carvers created afterwards;
+ * it can also be forced by setting the LQR_CPU_LEVEL environment
+ * variable to one of "scalar", "sse4.2", "avx2", "avx512" or "auto" */
+LQR_PUBLIC LqrRetVal lqr_cpu_set_level(LqrCpuLevel level);
+LQR_PUBLIC LqrCpuLevel lqr_cpu_get_level(void);
+
+#endif /* __LQR_CPU_PUB_H__ */
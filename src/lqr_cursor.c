@@ -53,11 +53,20 @@ lqr_cursor_create(LqrCarver *owner)
 void
 lqr_cursor_destroy(LqrCursor *c)
 {
+    LRQ_FREE(c->vis.bits);
+    LRQ_FREE(c->vis.ranks);
+    LRQ_FREE(c->vis_prev.bits);
+    LRQ_FREE(c->vis_prev.ranks);
     LRQ_FREE(c);
 }
 
 /*** functions for moving around ***/
 
+/* the points are scanned by lines, each one stored in w0
+ * consecutive points of the map; the visible points of a line are
+ * found through lqr_cursor_vis_next and lqr_cursor_vis_prev, given
+ * the offset u of a point in the line */
+
 /* resets to starting point */
 void
 lqr_cursor_reset(LqrCursor *c)
@@ -74,16 +83,25 @@ lqr_cursor_reset(LqrCursor *c)
     c->x = 0;
     c->y = 0;
 
-    /* set the current point to the beginning of the map */
-    c->now = 0;
+    /* the level or the map may have changed */
+    lqr_cursor_vis_update(c);
 
-    /* skip invisible points */
-    while ((c->o->vs[c->now] != 0) && (c->o->vs[c->now] < c->o->level)) {
-        c->now++;
+    /* set the current point to the first visible one */
+    c->now = lqr_cursor_vis_next(c, 0, 0);
 #ifdef __LQR_DEBUG__
-        assert(c->now < c->o->w0);
+    assert(c->now < c->o->w0);
 #endif /* __LQR_DEBUG__ */
-    }
+}
+
+/* make the cursor scan the owner carver at width w and at the
+ * corresponding level, regardless of the carver's own, and reset it */
+void
+lqr_cursor_pin(LqrCursor *c, int w, int level)
+{
+    c->pinned = true;
+    c->w = w;
+    c->level = level;
+    lqr_cursor_reset(c);
 }
 
 /* go to next data (first rows, then columns;
@@ -91,6 +109,9 @@ lqr_cursor_reset(LqrCursor *c)
 void
 lqr_cursor_next(LqrCursor *c)
 {
+    int u;
+    uint64_t word;
+
 #ifdef __LQR_DEBUG__
     assert(c->initialized);
 #endif /* __LQR_DEBUG__ */
@@ -101,7 +122,7 @@ lqr_cursor_next(LqrCursor *c)
     }
 
     /* update coordinates */
-    if (c->x == c->o->w - 1) {
+    if (c->x == c->w - 1) {
         if (c->y == c->o->h - 1) {
             /* top-right corner, set eoc flag */
             c->eoc = 1;
@@ -110,30 +131,33 @@ lqr_cursor_next(LqrCursor *c)
         /* end-of-line, carriage return */
         c->x = 0;
         c->y++;
+        u = 0;
     } else {
         /* simple right move */
         c->x++;
+        u = c->now + 1 - c->y * c->o->w0;
     }
 
-    /* first move */
-    c->now++;
-#ifdef __LQR_DEBUG__
-    assert(c->now < (c->o->w0 * c->o->h0));
-#endif /* __LQR_DEBUG__ */
-
-    /* skip invisible points */
-    while ((c->o->vs[c->now] != 0) && (c->o->vs[c->now] < c->o->level)) {
+    /* move to the next visible point (looking first at the
+     * bitmap word of the next point) */
+    if (c->vis_mode == LQR_CURSOR_VIS_ALL) {
         c->now++;
+    } else if ((c->vis_mode == LQR_CURSOR_VIS_BITMAP) && (u < c->o->w0)
+               && ((word = c->vis.bits[(size_t) c->y * c->vis.words + u / 64] >> (u % 64)) != 0)) {
+        c->now = c->y * c->o->w0 + u + LQR_VIS_FIRST(word);
+    } else {
+        c->now = c->y * c->o->w0 + lqr_cursor_vis_next(c, c->y, u);
+    }
 #ifdef __LQR_DEBUG__
-        assert(c->now < (c->o->w0 * c->o->h0));
+    assert(c->now < (c->o->w0 * c->o->h0));
 #endif /* __LQR_DEBUG__ */
-    }
 }
 
 /* go to previous data (behaves opposite to next) */
 void
 lqr_cursor_prev(LqrCursor *c)
 {
+    int u;
 
     /* are we at the end of carver ? */
     if (c->eoc) {
@@ -147,28 +171,329 @@ lqr_cursor_prev(LqrCursor *c)
             return;
         }
         /* carriage return */
-        c->x = c->o->w - 1;
+        c->x = c->w - 1;
         c->y--;
+        u = c->o->w0 - 1;
     } else {
         /* simple left move */
         c->x--;
+        u = c->now - 1 - c->y * c->o->w0;
     }
 
-    /* first move */
-    c->now--;
+    /* move to the previous visible point */
+    c->now = c->y * c->o->w0 + lqr_cursor_vis_prev(c, c->y, u);
 #ifdef __LQR_DEBUG__
     assert(c->now >= 0);
 #endif /* __LQR_DEBUG__ */
+}
 
-    /* skip invisible points */
-    while ((c->o->vs[c->now] != 0) && (c->o->vs[c->now] < c->o->level)) {
-        c->now--;
+/* go to the first data of the next line */
+void
+lqr_cursor_next_line(LqrCursor *c)
+{
 #ifdef __LQR_DEBUG__
-        assert(c->now >= 0);
+    assert(c->initialized);
 #endif /* __LQR_DEBUG__ */
+
+    /* are we at the end? */
+    if (c->eoc) {
+        return;
     }
+
+    if (c->y == c->o->h - 1) {
+        /* last line, set eoc flag */
+        c->x = c->w - 1;
+        c->eoc = 1;
+        return;
+    }
+
+    /* carriage return */
+    c->x = 0;
+    c->y++;
+    c->now = c->y * c->o->w0 + lqr_cursor_vis_next(c, c->y, 0);
+#ifdef __LQR_DEBUG__
+    assert(c->now < (c->o->w0 * c->o->h0));
+#endif /* __LQR_DEBUG__ */
 }
 
+/*** visibility bitmap ***/
+
+/* make the bitmap match the level and the map (the level follows
+ * the carver's unless the cursor is pinned); at level 1 all the
+ * points are visible, and if the bitmap cannot be allocated the
+ * map is scanned instead */
+void
+lqr_cursor_vis_update(LqrCursor *c)
+{
+    LqrCarver *r = c->o;
+    LqrCursorVisMap swap;
+    const int *row;
+    uint64_t word;
+    unsigned int level;
+    int y, i, u, u_max, rank;
+
+    if (!c->pinned) {
+        c->w = r->w;
+        c->level = r->level;
+    }
+
+    if (c->level == 1) {
+        c->vis_mode = LQR_CURSOR_VIS_ALL;
+        return;
+    }
+    c->vis_mode = LQR_CURSOR_VIS_BITMAP;
+    if (lqr_cursor_vis_valid(c, &c->vis)) {
+        return;
+    }
+
+    /* the previous bitmap is either the right one or recycled */
+    swap = c->vis;
+    c->vis = c->vis_prev;
+    c->vis_prev = swap;
+    if (lqr_cursor_vis_valid(c, &c->vis)) {
+        return;
+    }
+
+    c->vis.words = (r->w0 + 63) / 64;
+    c->vis.bits = LQR_CARVER_RESERVE(r, c->vis.bits, uint64_t, (size_t) c->vis.words * r->h0);
+    c->vis.ranks = LQR_CARVER_RESERVE(r, c->vis.ranks, int, (size_t) c->vis.words * r->h0);
+    if ((c->vis.bits == NULL) || (c->vis.ranks == NULL)) {
+        LRQ_FREE(c->vis.bits);
+        LRQ_FREE(c->vis.ranks);
+        c->vis_mode = LQR_CURSOR_VIS_SCAN;
+        return;
+    }
+
+    /* a point is visible if its level is 0 or at least the
+     * current one, i.e. if its level minus one is at least the
+     * current one minus one, in unsigned arithmetic (so that 0
+     * wraps around) */
+    level = c->level;
+    for (y = 0; y < r->h0; y++) {
+        row = r->vs + (size_t) y * r->w0;
+        for (i = 0, rank = 0; i < c->vis.words; i++) {
+            word = 0;
+            u_max = MIN(64, r->w0 - i * 64);
+            for (u = 0; u < u_max; u++) {
+                word |= (uint64_t) ((unsigned int) row[i * 64 + u] - 1 >= level - 1) << u;
+            }
+            c->vis.bits[(size_t) y * c->vis.words + i] = word;
+            c->vis.ranks[(size_t) y * c->vis.words + i] = rank;
+            rank += LQR_VIS_COUNT(word);
+        }
+    }
+
+    c->vis.level = c->level;
+    c->vis.vs = r->vs;
+    c->vis.w0 = r->w0;
+    c->vis.h0 = r->h0;
+    c->vis.serial = (r->root ? r->root : r)->vs_serial;
+}
+
+/* whether a bitmap matches the current level and map */
+bool
+lqr_cursor_vis_valid(LqrCursor *c, LqrCursorVisMap *vis)
+{
+    LqrCarver *r = c->o;
+
+    return (vis->bits != NULL) && (vis->level == c->level) && (vis->vs == r->vs) && (vis->w0 == r->w0)
+        && (vis->h0 == r->h0) && (vis->serial == (r->root ? r->root : r)->vs_serial);
+}
+
+/* offset of the first visible point of line y at or after u
+ * (w0 if there is none) */
+int
+lqr_cursor_vis_next(LqrCursor *c, int y, int u)
+{
+    const uint64_t *row;
+    const int *vs;
+    uint64_t word;
+    int i;
+
+    if (u >= c->o->w0) {
+        return c->o->w0;
+    }
+    switch (c->vis_mode) {
+        case LQR_CURSOR_VIS_ALL:
+            return u;
+        case LQR_CURSOR_VIS_BITMAP:
+            row = c->vis.bits + (size_t) y * c->vis.words;
+            i = u / 64;
+            word = row[i] & (~(uint64_t) 0 << (u % 64));
+            while (word == 0) {
+                if (++i == c->vis.words) {
+                    return c->o->w0;
+                }
+                word = row[i];
+            }
+            return i * 64 + LQR_VIS_FIRST(word);
+        default:
+            vs = c->o->vs + (size_t) y * c->o->w0;
+            while ((u < c->o->w0) && (vs[u] != 0) && (vs[u] < c->level)) {
+                u++;
+            }
+            return u;
+    }
+}
+
+/* offset of the last visible point of line y at or before u
+ * (-1 if there is none) */
+int
+lqr_cursor_vis_prev(LqrCursor *c, int y, int u)
+{
+    const uint64_t *row;
+    const int *vs;
+    uint64_t word;
+    int i;
+
+    if (u < 0) {
+        return -1;
+    }
+    switch (c->vis_mode) {
+        case LQR_CURSOR_VIS_ALL:
+            return u;
+        case LQR_CURSOR_VIS_BITMAP:
+            row = c->vis.bits + (size_t) y * c->vis.words;
+            i = u / 64;
+            word = row[i] & (~(uint64_t) 0 >> (63 - u % 64));
+            while (word == 0) {
+                if (--i < 0) {
+                    return -1;
+                }
+                word = row[i];
+            }
+            return i * 64 + LQR_VIS_LAST(word);
+        default:
+            vs = c->o->vs + (size_t) y * c->o->w0;
+            while ((u >= 0) && (vs[u] != 0) && (vs[u] < c->level)) {
+                u--;
+            }
+            return u;
+    }
+}
+
+/* offset of the first visible point of line y at or after u, as
+ * lqr_cursor_vis_next; end is set past the last one of its run of
+ * consecutive visible points */
+int
+lqr_cursor_vis_run(LqrCursor *c, int y, int u, int *end)
+{
+    const uint64_t *row;
+    const int *vs;
+    uint64_t word;
+    int i, v;
+
+    u = lqr_cursor_vis_next(c, y, u);
+    if (u == c->o->w0) {
+        (*end) = u;
+        return u;
+    }
+    switch (c->vis_mode) {
+        case LQR_CURSOR_VIS_ALL:
+            (*end) = c->o->w0;
+            break;
+        case LQR_CURSOR_VIS_BITMAP:
+            /* the padding bits are clear, so the run stops at w0 */
+            row = c->vis.bits + (size_t) y * c->vis.words;
+            i = u / 64;
+            word = ~row[i] & (~(uint64_t) 0 << (u % 64));
+            while (word == 0) {
+                if (++i == c->vis.words) {
+                    (*end) = c->o->w0;
+                    return u;
+                }
+                word = ~row[i];
+            }
+            (*end) = i * 64 + LQR_VIS_FIRST(word);
+            break;
+        default:
+            vs = c->o->vs + (size_t) y * c->o->w0;
+            for (v = u + 1; (v < c->o->w0) && ((vs[v] == 0) || (vs[v] >= c->level)); v++) {
+            }
+            (*end) = v;
+            break;
+    }
+    return u;
+}
+
+/* offset of the visible point of line y which is at position x
+ * once the invisible points are skipped (0 <= x < width); with the
+ * bitmap, the word holding it is found by bisection over the counts
+ * of visible points before each word */
+int
+lqr_cursor_vis_select(LqrCursor *c, int y, int x)
+{
+    const uint64_t *row;
+    const int *ranks;
+    uint64_t word;
+    int lo, hi, mid, k, u;
+
+    switch (c->vis_mode) {
+        case LQR_CURSOR_VIS_ALL:
+            return x;
+        case LQR_CURSOR_VIS_BITMAP:
+            row = c->vis.bits + (size_t) y * c->vis.words;
+            ranks = c->vis.ranks + (size_t) y * c->vis.words;
+            /* last word with at most x visible points before it */
+            lo = 0;
+            hi = c->vis.words - 1;
+            while (lo < hi) {
+                mid = (lo + hi + 1) / 2;
+                if (ranks[mid] <= x) {
+                    lo = mid;
+                } else {
+                    hi = mid - 1;
+                }
+            }
+            /* drop the visible points of the word which come before */
+            word = row[lo];
+            for (k = x - ranks[lo]; k > 0; k--) {
+                word &= word - 1;
+            }
+            return lo * 64 + LQR_VIS_FIRST(word);
+        default:
+            for (u = lqr_cursor_vis_next(c, y, 0); x > 0; x--) {
+                u = lqr_cursor_vis_next(c, y, u + 1);
+            }
+            return u;
+    }
+}
+
+#ifndef __GNUC__
+int
+lqr_cursor_vis_first(uint64_t word)
+{
+    int n = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        n++;
+    }
+    return n;
+}
+
+int
+lqr_cursor_vis_last(uint64_t word)
+{
+    int n = 63;
+    while (!(word >> 63)) {
+        word <<= 1;
+        n--;
+    }
+    return n;
+}
+
+int
+lqr_cursor_vis_count(uint64_t word)
+{
+    int n = 0;
+    while (word) {
+        word &= word - 1;
+        n++;
+    }
+    return n;
+}
+#endif /* __GNUC__ */
+
 /*** methods for exploring neighborhoods ***/
 
 /* these return pointers to neighboring data
@@ -177,29 +502,13 @@ lqr_cursor_prev(LqrCursor *c)
 int
 lqr_cursor_left(LqrCursor *c)
 {
-    /* create an auxiliary pointer */
-    int ret = c->now;
-
 #ifdef __LQR_DEBUG__
     assert(c->initialized);
     assert(c->x > 0);
     assert(c->eoc == 0);
 #endif /* __LQR_DEBUG__ */
 
-    /* first move */
-    ret--;
-#ifdef __LQR_DEBUG__
-    assert(ret >= 0);
-#endif /* __LQR_DEBUG__ */
-
-    /* skip invisible points */
-    while ((c->o->vs[ret] != 0) && c->o->vs[ret] < c->o->level) {
-        ret--;
-#ifdef __LQR_DEBUG__
-        assert(ret >= 0);
-#endif /* __LQR_DEBUG__ */
-    }
-    return ret;
+    return c->y * c->o->w0 + lqr_cursor_vis_prev(c, c->y, c->now - 1 - c->y * c->o->w0);
 }
 
 /**** END OF LQR_CURSOR_CURSOR CLASS FUNCTIONS ****/
@@ -23,13 +23,55 @@
 #ifndef __LQR_CURSOR_PRIV_H__
 #define __LQR_CURSOR_PRIV_H__
 
+#include <stdint.h>
+
 #ifndef __LQR_BASE_H__
 #error "lqr_base.h must be included prior to lqr_cursor_priv.h"
 #endif /* __LQR_BASE_H__ */
 
+/* How the cursor finds the visible points */
+enum _LqrCursorVis {
+    LQR_CURSOR_VIS_SCAN,                /* by scanning the visibility map */
+    LQR_CURSOR_VIS_ALL,                 /* all the points are visible */
+    LQR_CURSOR_VIS_BITMAP               /* through the visibility bitmap */
+};
+
+typedef enum _LqrCursorVis LqrCursorVis;
+
+/* first and last set bit of a non-zero bitmap word, and number of
+ * set bits of a word */
+#ifdef __GNUC__
+#define LQR_VIS_FIRST(word) (__builtin_ctzll(word))
+#define LQR_VIS_LAST(word) (63 - __builtin_clzll(word))
+#define LQR_VIS_COUNT(word) (__builtin_popcountll(word))
+#else
+#define LQR_VIS_FIRST(word) (lqr_cursor_vis_first(word))
+#define LQR_VIS_LAST(word) (lqr_cursor_vis_last(word))
+#define LQR_VIS_COUNT(word) (lqr_cursor_vis_count(word))
+#endif /* __GNUC__ */
+
+/* A packed copy of the visibility of the points of a map at a level */
+struct _LqrCursorVisMap {
+    uint64_t *bits;                     /* one bit per point, rows padded to whole words */
+    int *ranks;                         /* visible points of the row before each word */
+    int words;                          /* words per row */
+    int level;                          /* level, map, map size and map serial */
+    int *vs;                            /* the bits were computed for */
+    int w0;
+    int h0;
+    unsigned int serial;
+};
+
+typedef struct _LqrCursorVisMap LqrCursorVisMap;
+
 /**** LQR_CURSOR CLASS DEFINITION ****/
 /* The lqr_cursors can scan a multisize image according to its
- * current visibility level, skipping invisible points */
+ * current visibility level (or to another one, for the readers),
+ * skipping invisible points; to do so
+ * they keep a packed copy of the visibility of the points at that
+ * level, which is rebuilt when the level or the map change (the
+ * previous one is kept too, since some operations read the map at
+ * another level and then go back) */
 struct _LqrCursor {
 #ifdef __LQR_DEBUG__
     int initialized;                   /* initialization flag */
@@ -39,6 +81,14 @@ struct _LqrCursor {
     int now;                           /* current array position */
     LqrCarver *o;                       /* pointer to owner carver */
     char eoc;                          /* end of carver flag */
+
+    int w;                             /* width and level at which */
+    int level;                         /* the carver is scanned */
+    bool pinned;                       /* if false, they follow the carver's */
+
+    LqrCursorVis vis_mode;              /* how the visible points are found */
+    LqrCursorVisMap vis;                /* visibility bitmap */
+    LqrCursorVisMap vis_prev;           /* previous visibility bitmap */
 };
 
 /* LQR_CURSOR CLASS PRIVATE FUNCTIONS */
@@ -51,8 +101,23 @@ void lqr_cursor_destroy(LqrCursor *c);
 
 /* functions for moving around */
 void lqr_cursor_reset(LqrCursor *c);
+void lqr_cursor_pin(LqrCursor *c, int w, int level);
 void lqr_cursor_next(LqrCursor *c);
 void lqr_cursor_prev(LqrCursor *c);
+void lqr_cursor_next_line(LqrCursor *c);
+
+/* visibility bitmap */
+void lqr_cursor_vis_update(LqrCursor *c);
+bool lqr_cursor_vis_valid(LqrCursor *c, LqrCursorVisMap *vis);
+int lqr_cursor_vis_next(LqrCursor *c, int y, int u);
+int lqr_cursor_vis_prev(LqrCursor *c, int y, int u);
+int lqr_cursor_vis_run(LqrCursor *c, int y, int u, int *end);
+int lqr_cursor_vis_select(LqrCursor *c, int y, int x);
+#ifndef __GNUC__
+int lqr_cursor_vis_first(uint64_t word);
+int lqr_cursor_vis_last(uint64_t word);
+int lqr_cursor_vis_count(uint64_t word);
+#endif /* __GNUC__ */
 
 /* methods for exploring neighborhoods */
 int lqr_cursor_left(LqrCursor *c);
@@ -31,14 +31,21 @@
 #include <math.h>
 #include <float.h> /* FLT_MAX */
 #include "lqr_base.h"
+#include "lqr_mem.h"
 #include "lqr_gradient.h"
 #include "lqr_rwindow.h"
 #include "lqr_energy.h"
 #include "lqr_progress_pub.h"
 #include "lqr_cursor_pub.h"
+#include "lqr_thread_pool.h"
+#include "lqr_minpath.h"
+#include "lqr_cpu.h"
+#include "lqr_stats.h"
 #include "lqr_vmap.h"
 #include "lqr_vmap_list.h"
 #include "lqr_carver_list.h"
+#include "lqr_carver_pyramid.h"
+#include "lqr_carver_dual.h"
 #include "lqr_carver.h"
 
 #ifdef __LQR_DEBUG__
@@ -304,7 +311,7 @@ lqr_carver_read_custom(LqrCarver *r, int x, int y, int channel)
 double
 lqr_carver_read_cached_std(LqrCarver *r, int x, int y)
 {
-    int z0 = r->raw[y][x];
+    int z0 = LQR_MAP_INDEX(r, x, y);
 
     return r->rcache[z0];
 }
@@ -312,7 +319,7 @@ lqr_carver_read_cached_std(LqrCarver *r, int x, int y)
 double
 lqr_carver_read_cached_rgba(LqrCarver *r, int x, int y, int channel)
 {
-    int z0 = r->raw[y][x];
+    int z0 = LQR_MAP_INDEX(r, x, y);
 
     return r->rcache[z0 * 4 + channel];
 }
@@ -320,7 +327,7 @@ lqr_carver_read_cached_rgba(LqrCarver *r, int x, int y, int channel)
 double
 lqr_carver_read_cached_custom(LqrCarver *r, int x, int y, int channel)
 {
-    int z0 = r->raw[y][x];
+    int z0 = LQR_MAP_INDEX(r, x, y);
 
     return r->rcache[z0 * r->channels + channel];
 }
@@ -386,6 +393,23 @@ lqr_energy_builtin_grad_xabs(int x, int y, int img_width, int img_height, LqrRea
     return lqr_energy_builtin_grad_all(x, y, img_width, img_height, rwindow, lqr_grad_xabs);
 }
 
+/* find out whether an energy function is one of the builtin
+ * gradient functions, and which gradient it uses */
+bool
+lqr_energy_builtin_grad_type(LqrEnergyFunc nrg, LqrGradFuncType *gf_type)
+{
+    if (nrg == lqr_energy_builtin_grad_norm) {
+        *gf_type = LQR_GF_NORM;
+    } else if (nrg == lqr_energy_builtin_grad_sumabs) {
+        *gf_type = LQR_GF_SUMABS;
+    } else if (nrg == lqr_energy_builtin_grad_xabs) {
+        *gf_type = LQR_GF_XABS;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 float
 lqr_energy_builtin_null(int x, int y, int img_width, int img_height, LqrReadingWindow *rwindow, void * extra_data)
 {
@@ -443,15 +467,23 @@ lqr_carver_set_energy_function(LqrCarver *r, LqrEnergyFunc en_func, int radius,
 
     lqr_rwindow_destroy(r->rwindow);
 
-    if (reader_type == LQR_ER_CUSTOM) {
-        LQR_CATCH_MEM(r->rwindow = lqr_rwindow_new_custom(radius, r->use_rcache, r->channels));
-    } else {
-        LQR_CATCH_MEM(r->rwindow = lqr_rwindow_new(radius, reader_type, r->use_rcache));
-    }
+    LQR_CATCH_MEM(r->rwindow = lqr_carver_rwindow_new(r));
 
     return LQR_OK;
 }
 
+/* create a new reading window for the carver's
+ * current energy function settings */
+LqrReadingWindow *
+lqr_carver_rwindow_new(LqrCarver *r)
+{
+    if (r->nrg_read_t == LQR_ER_CUSTOM) {
+        return lqr_rwindow_new_custom(r->nrg_radius, r->use_rcache, r->channels);
+    } else {
+        return lqr_rwindow_new(r->nrg_radius, r->nrg_read_t, r->use_rcache);
+    }
+}
+
 double *
 lqr_carver_generate_rcache_bright(LqrCarver *r)
 {
@@ -459,11 +491,12 @@ lqr_carver_generate_rcache_bright(LqrCarver *r)
     int x, y;
     int z0;
 
-    LQR_TRY_N_N(buffer = LRQ_CALLOC(double, r->w0 * r->h0));
+    LQR_TRY_N_N(buffer = LQR_CARVER_CALLOC(r, double, r->w0 * r->h0));
 
     for (y = 0; y < r->h; y++) {
+        LQR_CATCH_CANC_ROW_N(r, buffer);
         for (x = 0; x < r->w; x++) {
-            z0 = r->raw[y][x];
+            z0 = LQR_MAP_INDEX(r, x, y);
             buffer[z0] = lqr_carver_read_brightness(r, x, y);
         }
     }
@@ -478,11 +511,12 @@ lqr_carver_generate_rcache_luma(LqrCarver *r)
     int x, y;
     int z0;
 
-    LQR_TRY_N_N(buffer = LRQ_CALLOC(double, r->w0 * r->h0));
+    LQR_TRY_N_N(buffer = LQR_CARVER_CALLOC(r, double, r->w0 * r->h0));
 
     for (y = 0; y < r->h; y++) {
+        LQR_CATCH_CANC_ROW_N(r, buffer);
         for (x = 0; x < r->w; x++) {
-            z0 = r->raw[y][x];
+            z0 = LQR_MAP_INDEX(r, x, y);
             buffer[z0] = lqr_carver_read_luma(r, x, y);
         }
     }
@@ -497,11 +531,12 @@ lqr_carver_generate_rcache_rgba(LqrCarver *r)
     int x, y, k;
     int z0;
 
-    LQR_TRY_N_N(buffer = LRQ_CALLOC(double, r->w0 * r->h0 * 4));
+    LQR_TRY_N_N(buffer = LQR_CARVER_CALLOC(r, double, r->w0 * r->h0 * 4));
 
     for (y = 0; y < r->h; y++) {
+        LQR_CATCH_CANC_ROW_N(r, buffer);
         for (x = 0; x < r->w; x++) {
-            z0 = r->raw[y][x];
+            z0 = LQR_MAP_INDEX(r, x, y);
             for (k = 0; k < 4; k++) {
                 buffer[z0 * 4 + k] = lqr_carver_read_rgba(r, x, y, k);
             }
@@ -518,11 +553,12 @@ lqr_carver_generate_rcache_custom(LqrCarver *r)
     int x, y, k;
     int z0;
 
-    LQR_TRY_N_N(buffer = LRQ_CALLOC(double, r->w0 * r->h0 * r->channels));
+    LQR_TRY_N_N(buffer = LQR_CARVER_CALLOC(r, double, r->w0 * r->h0 * r->channels));
 
     for (y = 0; y < r->h; y++) {
+        LQR_CATCH_CANC_ROW_N(r, buffer);
         for (x = 0; x < r->w; x++) {
-            z0 = r->raw[y][x];
+            z0 = LQR_MAP_INDEX(r, x, y);
             for (k = 0; k < r->channels; k++) {
                 buffer[z0 * r->channels + k] = lqr_carver_read_custom(r, x, y, k);
             }
@@ -532,6 +568,20 @@ lqr_carver_generate_rcache_custom(LqrCarver *r)
     return buffer;
 }
 
+/* number of cached values per point */
+int
+lqr_carver_rcache_stride(LqrCarver *r)
+{
+    switch (r->nrg_read_t) {
+        case LQR_ER_RGBA:
+            return 4;
+        case LQR_ER_CUSTOM:
+            return r->channels;
+        default:
+            return 1;
+    }
+}
+
 double *
 lqr_carver_generate_rcache(LqrCarver *r)
 {
@@ -596,7 +646,7 @@ lqr_carver_get_energy(LqrCarver *r, float *buffer, int orientation)
 
     for (y = 0; y < h; y++) {
         for (x = 0; x < w; x++) {
-            data = orientation == 0 ? r->raw[y][x] : r->raw[x][y];
+            data = orientation == 0 ? LQR_MAP_INDEX(r, x, y) : LQR_MAP_INDEX(r, y, x);
             /* nrg = tanhf(r->en[data]); */
             nrg = LQR_SATURATE(r->en[data]);
             nrg_max = MAX(nrg_max, nrg);
@@ -648,7 +698,7 @@ lqr_carver_get_true_energy(LqrCarver *r, float *buffer, int orientation)
 
     for (y = 0; y < h; y++) {
         for (x = 0; x < w; x++) {
-            data = orientation == 0 ? r->raw[y][x] : r->raw[x][y];
+            data = orientation == 0 ? LQR_MAP_INDEX(r, x, y) : LQR_MAP_INDEX(r, y, x);
             /* nrg = tanhf(r->en[data]); */
             buffer[z0++] = r->en[data];
         }
@@ -744,7 +794,7 @@ lqr_carver_get_energy_image(LqrCarver *r, void *buffer, int orientation, LqrColD
 
     buf_size = r->w * r->h;
 
-    LQR_CATCH_MEM(aux_buffer = LRQ_CALLOC(float, buf_size));
+    LQR_CATCH_MEM(aux_buffer = LQR_CARVER_CALLOC(r, float, buf_size));
 
     if (orientation != lqr_carver_get_orientation(r)) {
         LQR_CATCH(lqr_carver_transpose(r));
@@ -756,7 +806,7 @@ lqr_carver_get_energy_image(LqrCarver *r, void *buffer, int orientation, LqrColD
 
     for (y = 0; y < h; y++) {
         for (x = 0; x < w; x++) {
-            data = orientation == 0 ? r->raw[y][x] : r->raw[x][y];
+            data = orientation == 0 ? LQR_MAP_INDEX(r, x, y) : LQR_MAP_INDEX(r, y, x);
             /* nrg = tanhf(r->en[data]); */
             nrg = LQR_SATURATE(r->en[data]);
             nrg_max = MAX(nrg_max, nrg);
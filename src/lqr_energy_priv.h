@@ -55,12 +55,19 @@ double lqr_carver_read_cached_std(LqrCarver *r, int x, int y);
 double lqr_carver_read_cached_rgba(LqrCarver *r, int x, int y, int channel);
 double lqr_carver_read_cached_custom(LqrCarver *r, int x, int y, int channel);
 
+/* reading window matching the carver's energy function */
+LqrReadingWindow *lqr_carver_rwindow_new(LqrCarver *r);
+
 /* cache brightness (or luma or else) to speedup energy computation */
 double *lqr_carver_generate_rcache_bright();
 double *lqr_carver_generate_rcache_luma();
 double *lqr_carver_generate_rcache_rgba();
 double *lqr_carver_generate_rcache_custom();
 double *lqr_carver_generate_rcache();
+int lqr_carver_rcache_stride(LqrCarver *r);
+
+/* gradient type of a builtin gradient energy function */
+bool lqr_energy_builtin_grad_type(LqrEnergyFunc nrg, LqrGradFuncType *gf_type);
 
 float lqr_energy_builtin_grad_all(int x, int y, int img_width, int img_height, LqrReadingWindow *rwindow,
                                    LqrGradFunc gf);
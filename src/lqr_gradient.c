@@ -25,8 +25,13 @@
 #endif
 
 #include <math.h>
+#include "lqr_base.h"
 #include "lqr_gradient.h"
 
+#ifdef LQR_HAVE_X86_SIMD
+#include <immintrin.h>
+#endif /* LQR_HAVE_X86_SIMD */
+
 /**** GRADIENT FUNCTIONS ****/
 
 float
@@ -47,4 +52,131 @@ lqr_grad_xabs(double x, double y)
     return (float) fabs(x);
 }
 
+/* gradients are computed in double precision as in
+ * lqr_energy_builtin_grad_all(), and only the final results
+ * are rounded to float; note that halving is exact, so that
+ * multiplying by 0.5 is the same as dividing by 2; this file is
+ * built with -ffp-contract=off, so that the squares in the norm
+ * are not fused into multiply-adds by the avx512f kernel */
+
+void
+lqr_grad_row_scalar(LqrGradFuncType gf_type, const double *up, const double *now, const double *down,
+                    double gy_fact, float *out, int x_start, int x_end)
+{
+    int x;
+    double gx, gy;
+
+    for (x = x_start; x < x_end; x++) {
+        gx = (now[x + 1] - now[x - 1]) / 2;
+        gy = (down[x] - up[x]) * gy_fact;
+        switch (gf_type) {
+            case LQR_GF_NORM:
+                out[x] = lqr_grad_norm(gx, gy);
+                break;
+            case LQR_GF_SUMABS:
+                out[x] = lqr_grad_sumabs(gx, gy);
+                break;
+            default:
+                out[x] = lqr_grad_xabs(gx, gy);
+                break;
+        }
+    }
+}
+
+#ifdef LQR_HAVE_X86_SIMD
+
+__attribute__((target("sse4.2")))
+void
+lqr_grad_row_sse42(LqrGradFuncType gf_type, const double *up, const double *now, const double *down,
+                   double gy_fact, float *out, int x_start, int x_end)
+{
+    int x;
+    __m128d gx, gy, g;
+    __m128d half = _mm_set1_pd(0.5);
+    __m128d fact = _mm_set1_pd(gy_fact);
+    __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+
+    for (x = x_start; x + 2 <= x_end; x += 2) {
+        gx = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(now + x + 1), _mm_loadu_pd(now + x - 1)), half);
+        gy = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(down + x), _mm_loadu_pd(up + x)), fact);
+        switch (gf_type) {
+            case LQR_GF_NORM:
+                g = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(gx, gx), _mm_mul_pd(gy, gy)));
+                break;
+            case LQR_GF_SUMABS:
+                g = _mm_mul_pd(_mm_add_pd(_mm_and_pd(gx, abs_mask), _mm_and_pd(gy, abs_mask)), half);
+                break;
+            default:
+                g = _mm_and_pd(gx, abs_mask);
+                break;
+        }
+        _mm_storel_pi((__m64 *) (out + x), _mm_cvtpd_ps(g));
+    }
+
+    lqr_grad_row_scalar(gf_type, up, now, down, gy_fact, out, x, x_end);
+}
+
+__attribute__((target("avx2")))
+void
+lqr_grad_row_avx2(LqrGradFuncType gf_type, const double *up, const double *now, const double *down,
+                  double gy_fact, float *out, int x_start, int x_end)
+{
+    int x;
+    __m256d gx, gy, g;
+    __m256d half = _mm256_set1_pd(0.5);
+    __m256d fact = _mm256_set1_pd(gy_fact);
+    __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+
+    for (x = x_start; x + 4 <= x_end; x += 4) {
+        gx = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(now + x + 1), _mm256_loadu_pd(now + x - 1)), half);
+        gy = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(down + x), _mm256_loadu_pd(up + x)), fact);
+        switch (gf_type) {
+            case LQR_GF_NORM:
+                g = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(gx, gx), _mm256_mul_pd(gy, gy)));
+                break;
+            case LQR_GF_SUMABS:
+                g = _mm256_mul_pd(_mm256_add_pd(_mm256_and_pd(gx, abs_mask), _mm256_and_pd(gy, abs_mask)), half);
+                break;
+            default:
+                g = _mm256_and_pd(gx, abs_mask);
+                break;
+        }
+        _mm_storeu_ps(out + x, _mm256_cvtpd_ps(g));
+    }
+
+    lqr_grad_row_scalar(gf_type, up, now, down, gy_fact, out, x, x_end);
+}
+
+__attribute__((target("avx512f")))
+void
+lqr_grad_row_avx512(LqrGradFuncType gf_type, const double *up, const double *now, const double *down,
+                    double gy_fact, float *out, int x_start, int x_end)
+{
+    int x;
+    __m512d gx, gy, g;
+    __m512d half = _mm512_set1_pd(0.5);
+    __m512d fact = _mm512_set1_pd(gy_fact);
+
+    for (x = x_start; x + 8 <= x_end; x += 8) {
+        gx = _mm512_mul_pd(_mm512_sub_pd(_mm512_loadu_pd(now + x + 1), _mm512_loadu_pd(now + x - 1)), half);
+        gy = _mm512_mul_pd(_mm512_sub_pd(_mm512_loadu_pd(down + x), _mm512_loadu_pd(up + x)), fact);
+        switch (gf_type) {
+            case LQR_GF_NORM:
+                g = _mm512_sqrt_pd(_mm512_add_pd(_mm512_mul_pd(gx, gx), _mm512_mul_pd(gy, gy)));
+                break;
+            case LQR_GF_SUMABS:
+                g = _mm512_mul_pd(_mm512_add_pd(_mm512_abs_pd(gx), _mm512_abs_pd(gy)), half);
+                break;
+            default:
+                g = _mm512_abs_pd(gx);
+                break;
+        }
+        _mm256_storeu_ps(out + x, _mm512_cvtpd_ps(g));
+    }
+
+    lqr_grad_row_scalar(gf_type, up, now, down, gy_fact, out, x, x_end);
+}
+
+#endif /* LQR_HAVE_X86_SIMD */
+
 /**** END OF GRADIENT FUNCTIONS ****/
@@ -23,6 +23,10 @@
 #ifndef __LQR_GRADIENT_PRIV_H__
 #define __LQR_GRADIENT_PRIV_H__
 
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_gradient_priv.h"
+#endif /* __LQR_BASE_H__ */
+
 /**** gradient functions for energy evluation ****/
 typedef float (*LqrGradFunc) (double, double);
 
@@ -30,4 +34,24 @@ float lqr_grad_norm(double x, double y);
 float lqr_grad_sumabs(double x, double y);
 float lqr_grad_xabs(double x, double y);
 
+/* row kernels: compute the gradient function gf_type (one of
+ * LQR_GF_NORM, LQR_GF_SUMABS or LQR_GF_XABS) of the points from
+ * x_start to x_end - 1, given the rows of values above, at and
+ * below them; the points must have both horizontal neighbours.
+ * The vertical difference is multiplied by gy_fact, the results
+ * are the same as calling the gradient function on each point */
+typedef void (*LqrGradRowFunc) (LqrGradFuncType gf_type, const double *up, const double *now, const double *down,
+                                double gy_fact, float *out, int x_start, int x_end);
+
+void lqr_grad_row_scalar(LqrGradFuncType gf_type, const double *up, const double *now, const double *down,
+                         double gy_fact, float *out, int x_start, int x_end);
+#ifdef LQR_HAVE_X86_SIMD
+void lqr_grad_row_sse42(LqrGradFuncType gf_type, const double *up, const double *now, const double *down,
+                        double gy_fact, float *out, int x_start, int x_end);
+void lqr_grad_row_avx2(LqrGradFuncType gf_type, const double *up, const double *now, const double *down,
+                       double gy_fact, float *out, int x_start, int x_end);
+void lqr_grad_row_avx512(LqrGradFuncType gf_type, const double *up, const double *now, const double *down,
+                         double gy_fact, float *out, int x_start, int x_end);
+#endif /* LQR_HAVE_X86_SIMD */
+
 #endif /* __LQR_GRADIENT_PRIV_H__ */
@@ -0,0 +1,315 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "lqr_all.h"
+
+#ifdef __LQR_DEBUG__
+#include <assert.h>
+#endif /* __LQR_DEBUG__ */
+
+/* the header must keep the blocks suitably aligned */
+_Static_assert(sizeof(LqrMemHeader) % _Alignof(max_align_t) == 0, "bad LqrMemHeader size");
+
+/* the allocator in use (the realloc hook is not called at present) */
+static LqrCallocFunc lqr_mem_calloc_func = lqr_mem_default_calloc;
+static LqrReallocFunc lqr_mem_realloc_func = lqr_mem_default_realloc;
+static LqrFreeFunc lqr_mem_free_func = lqr_mem_default_free;
+static void *lqr_mem_user_data = NULL;
+
+/* total memory allocated through lqr_mem_calloc */
+static atomic_size_t lqr_mem_usage;
+
+/**** LQR_MEM FUNCTIONS ****/
+
+void *
+lqr_mem_default_calloc(size_t count, size_t size, void *user_data)
+{
+    (void) user_data;
+    return calloc(count, size);
+}
+
+void *
+lqr_mem_default_realloc(void *ptr, size_t size, void *user_data)
+{
+    (void) user_data;
+    return realloc(ptr, size);
+}
+
+void
+lqr_mem_default_free(void *ptr, void *user_data)
+{
+    (void) user_data;
+    free(ptr);
+}
+
+/* charge size bytes to the account, fails if over the limit */
+bool
+lqr_mem_account_add(LqrMemAccount *account, size_t size)
+{
+    size_t live, peak;
+
+    live = atomic_fetch_add(&account->live, size) + size;
+    if ((account->limit != 0) && (live > account->limit)) {
+        atomic_fetch_sub(&account->live, size);
+        return false;
+    }
+    peak = atomic_load(&account->peak);
+    while ((live > peak) && !atomic_compare_exchange_weak(&account->peak, &peak, live)) {
+        /* retry */
+    }
+    return true;
+}
+
+void
+lqr_mem_account_sub(LqrMemAccount *account, size_t size)
+{
+#ifdef __LQR_DEBUG__
+    assert(atomic_load(&account->live) >= size);
+#endif /* __LQR_DEBUG__ */
+    atomic_fetch_sub(&account->live, size);
+}
+
+/* allocate a zeroed block of count * size bytes, preceded by
+ * a header, charging it to the given account (if not NULL) */
+void *
+lqr_mem_calloc(size_t count, size_t size, LqrMemAccount *account)
+{
+    LqrMemHeader *header;
+
+    if ((size != 0) && (count > (SIZE_MAX - sizeof(LqrMemHeader)) / size)) {
+        return NULL;
+    }
+    size *= count;
+    if ((account != NULL) && !lqr_mem_account_add(account, size)) {
+        return NULL;
+    }
+    header = lqr_mem_calloc_func(1, sizeof(LqrMemHeader) + size, lqr_mem_user_data);
+    if (header == NULL) {
+        if (account != NULL) {
+            lqr_mem_account_sub(account, size);
+        }
+        return NULL;
+    }
+    header->size = size;
+    header->account = account;
+    atomic_init(&header->refs, 1);
+    atomic_fetch_add(&lqr_mem_usage, size);
+    return header + 1;
+}
+
+/* get a block of at least count * size bytes for data which
+ * is about to be rewritten: ptr is returned as it is if it is
+ * large enough, otherwise it is freed and replaced by a larger
+ * block, with some room to grow; the contents are undefined
+ * unless zero is true. A shared block is never reused, since
+ * the other holders still read it. On failure ptr is freed */
+void *
+lqr_mem_reserve(void *ptr, size_t count, size_t size, bool zero, LqrMemAccount *account)
+{
+    size_t capacity = lqr_mem_capacity(ptr);
+    void *buf;
+
+    if ((size != 0) && (count > (SIZE_MAX - sizeof(LqrMemHeader)) / size)) {
+        lqr_mem_free(ptr);
+        return NULL;
+    }
+    size *= count;
+
+    if ((ptr != NULL) && (size <= capacity) && !lqr_mem_is_shared(ptr)) {
+        if (zero) {
+            memset(ptr, 0, size);
+        }
+#ifdef __LQR_DEBUG__
+        else {
+            /* make reads of stale data show up */
+            memset(ptr, 0xa5, capacity);
+        }
+#endif /* __LQR_DEBUG__ */
+        return ptr;
+    }
+
+    lqr_mem_free(ptr);
+    buf = NULL;
+    if ((size > capacity) && (capacity / 2 < SIZE_MAX - sizeof(LqrMemHeader) - capacity)) {
+        /* geometric growth, unless it exceeds the limits */
+        buf = lqr_mem_calloc(1, MAX(size, capacity + capacity / 2), account);
+    }
+    if (buf == NULL) {
+        buf = lqr_mem_calloc(1, size, account);
+    }
+#ifdef __LQR_DEBUG__
+    if ((buf != NULL) && !zero) {
+        memset(buf, 0xa5, lqr_mem_capacity(buf));
+    }
+#endif /* __LQR_DEBUG__ */
+    return buf;
+}
+
+/* usable size of a block (0 for NULL) */
+size_t
+lqr_mem_capacity(void *ptr)
+{
+    if (ptr == NULL) {
+        return 0;
+    }
+    return ((LqrMemHeader *) ptr - 1)->size;
+}
+
+void
+lqr_mem_free(void *ptr)
+{
+    LqrMemHeader *header;
+
+    if (ptr == NULL) {
+        return;
+    }
+    header = (LqrMemHeader *) ptr - 1;
+    if (atomic_fetch_sub(&header->refs, 1) > 1) {
+        /* still held by someone else */
+        return;
+    }
+    if (header->account != NULL) {
+        lqr_mem_account_sub(header->account, header->size);
+    }
+    atomic_fetch_sub(&lqr_mem_usage, header->size);
+    lqr_mem_free_func(header, lqr_mem_user_data);
+}
+
+/* add a holder to a block, which is then freed when all of them
+ * have freed it; since they may do so in any order, the block
+ * stops being charged to its account. Only the holders of a
+ * block may share it further */
+void *
+lqr_mem_share(void *ptr)
+{
+    LqrMemHeader *header;
+
+    if (ptr == NULL) {
+        return NULL;
+    }
+    header = (LqrMemHeader *) ptr - 1;
+    if (header->account != NULL) {
+        lqr_mem_account_sub(header->account, header->size);
+        header->account = NULL;
+    }
+    atomic_fetch_add(&header->refs, 1);
+    return ptr;
+}
+
+bool
+lqr_mem_is_shared(void *ptr)
+{
+    return (ptr != NULL) && (atomic_load(&((LqrMemHeader *) ptr - 1)->refs) > 1);
+}
+
+/* get a block which is about to be modified in place: a shared
+ * block is replaced by a private copy, charged to the given
+ * account (if not NULL); on failure NULL is returned and ptr is
+ * left untouched */
+void *
+lqr_mem_unshare(void *ptr, LqrMemAccount *account)
+{
+    void *buf;
+
+    if (!lqr_mem_is_shared(ptr)) {
+        return ptr;
+    }
+    buf = lqr_mem_calloc(1, lqr_mem_capacity(ptr), account);
+    if (buf == NULL) {
+        return NULL;
+    }
+    memcpy(buf, ptr, lqr_mem_capacity(ptr));
+    lqr_mem_free(ptr);
+    return buf;
+}
+
+void *
+lqr_mem_calloc_user(size_t count, size_t size)
+{
+    return lqr_mem_calloc_func(count, size, lqr_mem_user_data);
+}
+
+void
+lqr_mem_free_user(void *ptr)
+{
+    if (ptr != NULL) {
+        lqr_mem_free_func(ptr, lqr_mem_user_data);
+    }
+}
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_set_allocator(LqrCallocFunc calloc_func, LqrReallocFunc realloc_func, LqrFreeFunc free_func, void *user_data)
+{
+    if ((calloc_func == NULL) && (realloc_func == NULL) && (free_func == NULL)) {
+        calloc_func = lqr_mem_default_calloc;
+        realloc_func = lqr_mem_default_realloc;
+        free_func = lqr_mem_default_free;
+        user_data = NULL;
+    }
+    LQR_CATCH_F((calloc_func != NULL) && (realloc_func != NULL) && (free_func != NULL));
+
+    lqr_mem_calloc_func = calloc_func;
+    lqr_mem_realloc_func = realloc_func;
+    lqr_mem_free_func = free_func;
+    lqr_mem_user_data = user_data;
+
+    return LQR_OK;
+}
+
+/* LQR_PUBLIC */
+size_t
+lqr_get_memory_usage(void)
+{
+    return atomic_load(&lqr_mem_usage);
+}
+
+/* LQR_PUBLIC */
+size_t
+lqr_carver_get_memory_usage(LqrCarver *r)
+{
+    return atomic_load(&r->mem.live);
+}
+
+/* LQR_PUBLIC */
+size_t
+lqr_carver_get_memory_peak(LqrCarver *r)
+{
+    return atomic_load(&r->mem.peak);
+}
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_set_memory_limit(LqrCarver *r, size_t limit)
+{
+    r->mem.limit = limit;
+    return LQR_OK;
+}
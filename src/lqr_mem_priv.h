@@ -0,0 +1,91 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_MEM_PRIV_H__
+#define __LQR_MEM_PRIV_H__
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_mem_priv.h"
+#endif /* __LQR_BASE_H__ */
+
+#ifndef __LQR_MEM_PUB_H__
+#error "lqr_mem_pub.h must be included prior to lqr_mem_priv.h"
+#endif /* __LQR_MEM_PUB_H__ */
+
+/* allocation accounted to a carver (which must outlive it) */
+#define LQR_CARVER_CALLOC(r, type, count) \
+    (LQR_STATS_COUNT(r, bytes_allocated, (count) * sizeof(type)), \
+     (type *) lqr_mem_calloc((count), sizeof(type), &(r)->mem))
+
+/* buffers exchanged with the user, which are allocated and freed
+ * directly by the allocator (no header, no accounting) */
+#define LQR_USER_CALLOC(type, count) ((type *) lqr_mem_calloc_user((count), sizeof(type)))
+#define LQR_USER_FREE(ptr) lqr_mem_free_user(ptr)
+
+/**** LQR_MEM CLASS DEFINITION ****/
+
+/* memory accounting of a carver */
+struct _LqrMemAccount {
+    atomic_size_t live;                 /* currently allocated */
+    atomic_size_t peak;                 /* maximum of live */
+    size_t limit;                       /* maximum allowed (0 = none) */
+};
+
+typedef struct _LqrMemAccount LqrMemAccount;
+
+/* header of each block, holding its size, the account it is
+ * charged to (possibly NULL) and the number of its holders
+ * (more than one for the maps shared among clones) */
+struct _LqrMemHeader {
+    size_t size;
+    LqrMemAccount *account;
+    atomic_size_t refs;
+    size_t pad;                         /* keeps the size aligned */
+};
+
+typedef struct _LqrMemHeader LqrMemHeader;
+
+/* LQR_MEM PRIVATE FUNCTIONS */
+
+void *lqr_mem_calloc(size_t count, size_t size, LqrMemAccount *account);
+void *lqr_mem_reserve(void *ptr, size_t count, size_t size, bool zero, LqrMemAccount *account);
+size_t lqr_mem_capacity(void *ptr);
+void lqr_mem_free(void *ptr);
+
+void *lqr_mem_share(void *ptr);
+bool lqr_mem_is_shared(void *ptr);
+void *lqr_mem_unshare(void *ptr, LqrMemAccount *account);
+
+void *lqr_mem_calloc_user(size_t count, size_t size);
+void lqr_mem_free_user(void *ptr);
+
+bool lqr_mem_account_add(LqrMemAccount *account, size_t size);
+void lqr_mem_account_sub(LqrMemAccount *account, size_t size);
+
+void *lqr_mem_default_calloc(size_t count, size_t size, void *user_data);
+void *lqr_mem_default_realloc(void *ptr, size_t size, void *user_data);
+void lqr_mem_default_free(void *ptr, void *user_data);
+
+#endif /* __LQR_MEM_PRIV_H__ */
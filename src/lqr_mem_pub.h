@@ -0,0 +1,68 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_MEM_PUB_H__
+#define __LQR_MEM_PUB_H__
+
+#include <stddef.h>
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_mem_pub.h"
+#endif /* __LQR_BASE_H__ */
+
+/* allocator hooks (same semantics as calloc, realloc and free);
+ * the user_data pointer given to lqr_set_allocator is passed along.
+ * The realloc hook is reserved: it must be given, but the library
+ * does not call it at present (maps which grow are replaced, since
+ * their contents are rewritten anyway) */
+typedef void *(*LqrCallocFunc) (size_t count, size_t size, void *user_data);
+typedef void *(*LqrReallocFunc) (void *ptr, size_t size, void *user_data);
+typedef void (*LqrFreeFunc) (void *ptr, void *user_data);
+
+/* LQR_MEM PUBLIC FUNCTIONS */
+
+/* the allocator is global: it must be set before any other library
+ * call (or after all the carvers and maps have been destroyed);
+ * passing all NULL functions restores the standard library ones.
+ * The buffers given to lqr_carver_new and lqr_vmap_new, which are
+ * freed by the library, must be allocated with the same allocator */
+LQR_PUBLIC LqrRetVal lqr_set_allocator(LqrCallocFunc calloc_func, LqrReallocFunc realloc_func,
+                                       LqrFreeFunc free_func, void *user_data);
+
+/* total size of the memory currently allocated by the library
+ * (excluding the image buffers and visibility maps exchanged
+ * with the user) */
+LQR_PUBLIC size_t lqr_get_memory_usage(void);
+
+/* memory used by the maps and buffers of a carver (attached
+ * carvers are accounted separately, the maps shared with clones
+ * are not accounted): currently allocated, and the maximum
+ * reached so far */
+LQR_PUBLIC size_t lqr_carver_get_memory_usage(LqrCarver *r);
+LQR_PUBLIC size_t lqr_carver_get_memory_peak(LqrCarver *r);
+
+/* make the allocations of a carver fail (so that the functions
+ * return LQR_NOMEM) when they would exceed the given amount of
+ * memory; 0 means no limit */
+LQR_PUBLIC LqrRetVal lqr_carver_set_memory_limit(LqrCarver *r, size_t limit);
+
+#endif /* __LQR_MEM_PUB_H__ */
@@ -0,0 +1,300 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "lqr_base.h"
+#include "lqr_minpath.h"
+
+#ifdef LQR_HAVE_X86_SIMD
+#include <immintrin.h>
+#include <string.h>
+#endif /* LQR_HAVE_X86_SIMD */
+
+#ifdef __LQR_DEBUG__
+#include <assert.h>
+#endif /* __LQR_DEBUG__ */
+
+/**** LQR_MINPATH_ROW CLASS FUNCTIONS ****/
+
+/* this is the same computation as in lqr_carver_build_mmap_row(),
+ * and all the other kernels must give exactly the same results:
+ * among equal minima, the leftmost one is chosen if leftright
+ * is 0, the rightmost one otherwise */
+void
+lqr_minpath_row_scalar(const LqrMinpathRow *row, int x_start, int x_end)
+{
+    int x;
+    int x1_min, x1_max, x1;
+    int x_least;
+    float m, m1, r_fact;
+
+    for (x = x_start; x < x_end; x++) {
+        /* watch for boundaries */
+        x1_min = MAX(-x, -row->delta_x);
+        x1_max = MIN(row->w - 1 - x, row->delta_x);
+
+        x_least = x + x1_min;
+        if (row->rigidity_map) {
+            if (row->rigidity_mask) {
+                r_fact = row->rigidity_mask[row->raw[x]];
+            } else {
+                r_fact = 1;
+            }
+            m = row->m_down[x_least] + r_fact * row->rigidity_map[x1_min];
+            for (x1 = x1_min + 1; x1 <= x1_max; x1++) {
+                m1 = row->m_down[x + x1] + r_fact * row->rigidity_map[x1];
+                if ((m1 < m) || ((m1 == m) && (row->leftright == 1))) {
+                    m = m1;
+                    x_least = x + x1;
+                }
+            }
+        } else {
+            m = row->m_down[x_least];
+            for (x1 = x1_min + 1; x1 <= x1_max; x1++) {
+                m1 = row->m_down[x + x1];
+                if ((m1 < m) || ((m1 == m) && (row->leftright == 1))) {
+                    m = m1;
+                    x_least = x + x1;
+                }
+            }
+        }
+
+        row->least[x] = (int8_t) (x_least - x);
+        row->m[x] = row->en[x] + m;
+    }
+}
+
+#ifdef LQR_HAVE_X86_SIMD
+
+/* The vectorized kernels only handle the points which have both
+ * neighbours (the others are left to the scalar kernel). The three
+ * candidates are compared left to right, using <= instead of < to
+ * implement the rightmost tie-breaking, and the predecessors offsets
+ * follow the same selection masks (they are packed to bytes when
+ * stored). No fused multiply-add is used, so
+ * that the rigidity term is rounded as in the scalar code (this
+ * file is built with -ffp-contract=off, since the compiler would
+ * otherwise fuse the rigidity terms of the avx512f kernel). */
+
+__attribute__((target("sse4.2")))
+void
+lqr_minpath_row_dx1_sse42(const LqrMinpathRow *row, int x_start, int x_end)
+{
+    int x, x_first;
+    int x_last = MIN(x_end, row->w - 1);
+    __m128 ml, mc, mr, m, sel, f;
+    __m128 rig_l, rig_c, rig_r;
+    __m128 ll, lc, lr, least;
+    __m128i least_8;
+    int least_4;
+
+#ifdef __LQR_DEBUG__
+    assert(row->delta_x == 1);
+#endif /* __LQR_DEBUG__ */
+
+    x_first = MAX(x_start, 1);
+    lqr_minpath_row_scalar(row, x_start, MIN(x_first, x_end));
+
+    if (row->rigidity_map) {
+        rig_l = _mm_set1_ps(row->rigidity_map[-1]);
+        rig_c = _mm_set1_ps(row->rigidity_map[0]);
+        rig_r = _mm_set1_ps(row->rigidity_map[1]);
+    } else {
+        rig_l = rig_c = rig_r = _mm_setzero_ps();
+    }
+    f = _mm_set1_ps(1);
+    ll = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    lc = _mm_castsi128_ps(_mm_setzero_si128());
+    lr = _mm_castsi128_ps(_mm_set1_epi32(1));
+
+    for (x = x_first; x + 4 <= x_last; x += 4) {
+        ml = _mm_loadu_ps(row->m_down + x - 1);
+        mc = _mm_loadu_ps(row->m_down + x);
+        mr = _mm_loadu_ps(row->m_down + x + 1);
+        if (row->rigidity_map) {
+            if (row->rigidity_mask) {
+                f = _mm_set_ps(row->rigidity_mask[row->raw[x + 3]], row->rigidity_mask[row->raw[x + 2]],
+                               row->rigidity_mask[row->raw[x + 1]], row->rigidity_mask[row->raw[x]]);
+            }
+            ml = _mm_add_ps(ml, _mm_mul_ps(f, rig_l));
+            mc = _mm_add_ps(mc, _mm_mul_ps(f, rig_c));
+            mr = _mm_add_ps(mr, _mm_mul_ps(f, rig_r));
+        }
+
+        sel = row->leftright ? _mm_cmple_ps(mc, ml) : _mm_cmplt_ps(mc, ml);
+        m = _mm_blendv_ps(ml, mc, sel);
+        least = _mm_blendv_ps(ll, lc, sel);
+        sel = row->leftright ? _mm_cmple_ps(mr, m) : _mm_cmplt_ps(mr, m);
+        m = _mm_blendv_ps(m, mr, sel);
+        least = _mm_blendv_ps(least, lr, sel);
+
+        _mm_storeu_ps(row->m + x, _mm_add_ps(_mm_loadu_ps(row->en + x), m));
+        least_8 = _mm_packs_epi32(_mm_castps_si128(least), _mm_castps_si128(least));
+        least_8 = _mm_packs_epi16(least_8, least_8);
+        least_4 = _mm_cvtsi128_si32(least_8);
+        memcpy(row->least + x, &least_4, 4);
+    }
+
+    lqr_minpath_row_scalar(row, MAX(x, x_start), x_end);
+}
+
+__attribute__((target("avx2")))
+void
+lqr_minpath_row_dx1_avx2(const LqrMinpathRow *row, int x_start, int x_end)
+{
+    int x, x_first;
+    int x_last = MIN(x_end, row->w - 1);
+    __m256 ml, mc, mr, m, sel, f;
+    __m256 rig_l, rig_c, rig_r;
+    __m256 ll, lc, lr, least;
+    __m128i least_8;
+
+#ifdef __LQR_DEBUG__
+    assert(row->delta_x == 1);
+#endif /* __LQR_DEBUG__ */
+
+    x_first = MAX(x_start, 1);
+    lqr_minpath_row_scalar(row, x_start, MIN(x_first, x_end));
+
+    if (row->rigidity_map) {
+        rig_l = _mm256_set1_ps(row->rigidity_map[-1]);
+        rig_c = _mm256_set1_ps(row->rigidity_map[0]);
+        rig_r = _mm256_set1_ps(row->rigidity_map[1]);
+    } else {
+        rig_l = rig_c = rig_r = _mm256_setzero_ps();
+    }
+    f = _mm256_set1_ps(1);
+    ll = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    lc = _mm256_castsi256_ps(_mm256_setzero_si256());
+    lr = _mm256_castsi256_ps(_mm256_set1_epi32(1));
+
+    for (x = x_first; x + 8 <= x_last; x += 8) {
+        ml = _mm256_loadu_ps(row->m_down + x - 1);
+        mc = _mm256_loadu_ps(row->m_down + x);
+        mr = _mm256_loadu_ps(row->m_down + x + 1);
+        if (row->rigidity_map) {
+            if (row->rigidity_mask) {
+                f = _mm256_i32gather_ps(row->rigidity_mask,
+                                        _mm256_loadu_si256((const __m256i *) (row->raw + x)), 4);
+            }
+            ml = _mm256_add_ps(ml, _mm256_mul_ps(f, rig_l));
+            mc = _mm256_add_ps(mc, _mm256_mul_ps(f, rig_c));
+            mr = _mm256_add_ps(mr, _mm256_mul_ps(f, rig_r));
+        }
+
+        if (row->leftright) {
+            sel = _mm256_cmp_ps(mc, ml, _CMP_LE_OQ);
+        } else {
+            sel = _mm256_cmp_ps(mc, ml, _CMP_LT_OQ);
+        }
+        m = _mm256_blendv_ps(ml, mc, sel);
+        least = _mm256_blendv_ps(ll, lc, sel);
+        if (row->leftright) {
+            sel = _mm256_cmp_ps(mr, m, _CMP_LE_OQ);
+        } else {
+            sel = _mm256_cmp_ps(mr, m, _CMP_LT_OQ);
+        }
+        m = _mm256_blendv_ps(m, mr, sel);
+        least = _mm256_blendv_ps(least, lr, sel);
+
+        _mm256_storeu_ps(row->m + x, _mm256_add_ps(_mm256_loadu_ps(row->en + x), m));
+        least_8 = _mm_packs_epi32(_mm256_castsi256_si128(_mm256_castps_si256(least)),
+                                  _mm256_extracti128_si256(_mm256_castps_si256(least), 1));
+        least_8 = _mm_packs_epi16(least_8, least_8);
+        _mm_storel_epi64((__m128i *) (row->least + x), least_8);
+    }
+
+    lqr_minpath_row_scalar(row, MAX(x, x_start), x_end);
+}
+
+__attribute__((target("avx512f")))
+void
+lqr_minpath_row_dx1_avx512(const LqrMinpathRow *row, int x_start, int x_end)
+{
+    int x, x_first;
+    int x_last = MIN(x_end, row->w - 1);
+    __m512 ml, mc, mr, m, f;
+    __m512 rig_l, rig_c, rig_r;
+    __m512i ll, lc, lr, least;
+    __mmask16 sel;
+    int cmp_op = row->leftright ? _CMP_LE_OQ : _CMP_LT_OQ;
+
+#ifdef __LQR_DEBUG__
+    assert(row->delta_x == 1);
+#endif /* __LQR_DEBUG__ */
+
+    x_first = MAX(x_start, 1);
+    lqr_minpath_row_scalar(row, x_start, MIN(x_first, x_end));
+
+    if (row->rigidity_map) {
+        rig_l = _mm512_set1_ps(row->rigidity_map[-1]);
+        rig_c = _mm512_set1_ps(row->rigidity_map[0]);
+        rig_r = _mm512_set1_ps(row->rigidity_map[1]);
+    } else {
+        rig_l = rig_c = rig_r = _mm512_setzero_ps();
+    }
+    f = _mm512_set1_ps(1);
+    ll = _mm512_set1_epi32(-1);
+    lc = _mm512_setzero_si512();
+    lr = _mm512_set1_epi32(1);
+
+    for (x = x_first; x + 16 <= x_last; x += 16) {
+        ml = _mm512_loadu_ps(row->m_down + x - 1);
+        mc = _mm512_loadu_ps(row->m_down + x);
+        mr = _mm512_loadu_ps(row->m_down + x + 1);
+        if (row->rigidity_map) {
+            if (row->rigidity_mask) {
+                f = _mm512_i32gather_ps(_mm512_loadu_si512(row->raw + x), row->rigidity_mask, 4);
+            }
+            ml = _mm512_add_ps(ml, _mm512_mul_ps(f, rig_l));
+            mc = _mm512_add_ps(mc, _mm512_mul_ps(f, rig_c));
+            mr = _mm512_add_ps(mr, _mm512_mul_ps(f, rig_r));
+        }
+
+        if (cmp_op == _CMP_LE_OQ) {
+            sel = _mm512_cmp_ps_mask(mc, ml, _CMP_LE_OQ);
+        } else {
+            sel = _mm512_cmp_ps_mask(mc, ml, _CMP_LT_OQ);
+        }
+        m = _mm512_mask_blend_ps(sel, ml, mc);
+        least = _mm512_mask_blend_epi32(sel, ll, lc);
+        if (cmp_op == _CMP_LE_OQ) {
+            sel = _mm512_cmp_ps_mask(mr, m, _CMP_LE_OQ);
+        } else {
+            sel = _mm512_cmp_ps_mask(mr, m, _CMP_LT_OQ);
+        }
+        m = _mm512_mask_blend_ps(sel, m, mr);
+        least = _mm512_mask_blend_epi32(sel, least, lr);
+
+        _mm512_storeu_ps(row->m + x, _mm512_add_ps(_mm512_loadu_ps(row->en + x), m));
+        _mm_storeu_si128((__m128i *) (row->least + x), _mm512_cvtepi32_epi8(least));
+    }
+
+    lqr_minpath_row_scalar(row, MAX(x, x_start), x_end);
+}
+
+#endif /* LQR_HAVE_X86_SIMD */
+
+/**** END OF LQR_MINPATH_ROW CLASS FUNCTIONS ****/
@@ -0,0 +1,67 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_MINPATH_PRIV_H__
+#define __LQR_MINPATH_PRIV_H__
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_minpath_priv.h"
+#endif /* __LQR_BASE_H__ */
+
+#ifndef __LQR_MINPATH_PUB_H__
+#error "lqr_minpath_pub.h must be included prior to lqr_minpath_priv.h"
+#endif /* __LQR_MINPATH_PUB_H__ */
+
+/**** LQR_MINPATH_ROW CLASS DEFINITION ****/
+
+/* All the pointers index points by column (i.e. they point
+ * to the beginning of a row of a compact layout carver map);
+ * the outputs are written only for the requested columns */
+struct _LqrMinpathRow {
+    int w;                              /* row width */
+    int delta_x;                        /* max seam step */
+    int leftright;                      /* tie-breaking: 0 = leftmost, 1 = rightmost */
+    const float *m_down;                /* minpath values of the previous row */
+    const int *raw;                     /* data indices of the current row */
+    const float *en;                    /* energy of the current row */
+    const float *rigidity_map;          /* rigidity by step (centered), NULL if no rigidity */
+    const float *rigidity_mask;         /* rigidity factors (data indexed), or NULL */
+    float *m;                           /* output minpath values */
+    int8_t *least;                      /* output predecessors (column offsets) */
+};
+
+/* row kernel: computes the columns from x_start to x_end - 1 */
+typedef void (*LqrMinpathRowFunc) (const LqrMinpathRow *row, int x_start, int x_end);
+
+/* LQR_MINPATH_ROW CLASS PRIVATE FUNCTIONS */
+
+/* generic kernel (any delta_x) */
+void lqr_minpath_row_scalar(const LqrMinpathRow *row, int x_start, int x_end);
+
+#ifdef LQR_HAVE_X86_SIMD
+/* vectorized kernels for delta_x = 1 */
+void lqr_minpath_row_dx1_sse42(const LqrMinpathRow *row, int x_start, int x_end);
+void lqr_minpath_row_dx1_avx2(const LqrMinpathRow *row, int x_start, int x_end);
+void lqr_minpath_row_dx1_avx512(const LqrMinpathRow *row, int x_start, int x_end);
+#endif /* LQR_HAVE_X86_SIMD */
+
+#endif /* __LQR_MINPATH_PRIV_H__ */
@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include "lqr_base.h"
+#include "lqr_mem.h"
 #include "lqr_progress.h"
 
 /* LQR_PUBLIC */
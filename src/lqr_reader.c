@@ -0,0 +1,239 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+
+#include "lqr_all.h"
+
+/**** LQR_READER CLASS FUNCTIONS ****/
+
+/*** constructor and destructor ***/
+
+/* the reader starts at the current size of the carver */
+/* LQR_PUBLIC */
+LqrReader *
+lqr_reader_new(LqrCarver *r)
+{
+    LqrReader *rd;
+
+    LQR_TRY_N_N(rd = LRQ_CALLOC(LqrReader, 1));
+    rd->o = r;
+    if ((rd->c = lqr_cursor_create(r)) == NULL) {
+        LRQ_FREE(rd);
+        return NULL;
+    }
+    if (lqr_reader_set_size(rd, lqr_carver_get_width(r), lqr_carver_get_height(r)) != LQR_OK) {
+        lqr_reader_destroy(rd);
+        return NULL;
+    }
+    return rd;
+}
+
+/* the readers must be destroyed before their carver */
+/* LQR_PUBLIC */
+void
+lqr_reader_destroy(LqrReader *rd)
+{
+    LRQ_FREE(rd->rgb_ro_buffer);
+    lqr_cursor_destroy(rd->c);
+    LRQ_FREE(rd);
+}
+
+/*** size ***/
+
+/* set the size at which the carver is read: only the size along
+ * the axis of the last resize can change, within the range covered
+ * by the maps already computed (i.e. down to the smallest size
+ * reached, and up to the size of the enlarged image, if it was) */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_reader_set_size(LqrReader *rd, int width, int height)
+{
+    LqrCarver *r = rd->o;
+    int w1;
+
+    if (!r->transposed) {
+        LQR_CATCH_F(height == r->h);
+        w1 = width;
+    } else {
+        LQR_CATCH_F(width == r->h);
+        w1 = height;
+    }
+    LQR_CATCH_F((w1 >= r->w_start - r->max_level + 1) && (w1 <= r->w0));
+
+    /* not usable until the buffer is there */
+    rd->w0 = 0;
+    LQR_CATCH_MEM(rd->rgb_ro_buffer = lqr_carver_reserve(r, rd->rgb_ro_buffer, (size_t) w1 * r->channels,
+                                                         PXL_SIZE(r->col_depth), false));
+
+    rd->w0 = r->w0;
+    rd->h0 = r->h0;
+    rd->transposed = r->transposed;
+    rd->serial = (r->root ? r->root : r)->vs_serial;
+
+    lqr_cursor_pin(rd->c, w1, r->w0 - w1 + 1);
+    return LQR_OK;
+}
+
+/* LQR_PUBLIC */
+int
+lqr_reader_get_width(LqrReader *rd)
+{
+    return (rd->o->transposed ? rd->o->h : rd->c->w);
+}
+
+/* LQR_PUBLIC */
+int
+lqr_reader_get_height(LqrReader *rd)
+{
+    return (rd->o->transposed ? rd->c->w : rd->o->h);
+}
+
+/* whether the carver still holds the maps the size was set for */
+bool
+lqr_reader_is_current(LqrReader *rd)
+{
+    LqrCarver *r = rd->o;
+
+    return (rd->w0 == r->w0) && (rd->h0 == r->h0) && (rd->transposed == r->transposed)
+        && (rd->serial == (r->root ? r->root : r)->vs_serial);
+}
+
+/*** readout (see the lqr_carver_scan functions; they all fail if
+ * the carver was modified since the size was set) ***/
+
+/* LQR_PUBLIC */
+void
+lqr_reader_scan_reset(LqrReader *rd)
+{
+    lqr_cursor_reset(rd->c);
+}
+
+/* readout all, pixel by pixel */
+/* LQR_PUBLIC */
+bool
+lqr_reader_scan_ext(LqrReader *rd, int *x, int *y, void **rgb)
+{
+    LqrCarver *r = rd->o;
+    size_t pxl_size = PXL_SIZE(r->col_depth) * r->channels;
+
+    if (!lqr_reader_is_current(rd)) {
+        return false;
+    }
+    if (rd->c->eoc) {
+        lqr_reader_scan_reset(rd);
+        return false;
+    }
+    LQR_STATS_TIMER(t0);
+    (*x) = (r->transposed ? rd->c->y : rd->c->x);
+    (*y) = (r->transposed ? rd->c->x : rd->c->y);
+    memcpy(rd->rgb_ro_buffer, (char *) r->rgb + (size_t) rd->c->now * pxl_size, pxl_size);
+
+    BUF_POINTER_COPY(rgb, rd->rgb_ro_buffer, r->col_depth);
+
+    lqr_cursor_next(rd->c);
+    LQR_STATS_PHASE(r, LQR_STATS_READOUT, t0);
+    return true;
+}
+
+/* readout all, by line (the runs of visible points of the line
+ * are copied at once) */
+/* LQR_PUBLIC */
+bool
+lqr_reader_scan_line_ext(LqrReader *rd, int *n, void **rgb)
+{
+    LqrCarver *r = rd->o;
+
+    if (!lqr_reader_is_current(rd)) {
+        return false;
+    }
+    if (rd->c->eoc) {
+        lqr_reader_scan_reset(rd);
+        return false;
+    }
+    LQR_STATS_TIMER(t0);
+    (*n) = rd->c->y;
+    lqr_carver_copy_line(r, rd->c, rd->c->y, rd->c->w, rd->rgb_ro_buffer);
+    lqr_cursor_next_line(rd->c);
+
+    BUF_POINTER_COPY(rgb, rd->rgb_ro_buffer, r->col_depth);
+
+    LQR_STATS_PHASE(r, LQR_STATS_READOUT, t0);
+    return true;
+}
+
+/* LQR_PUBLIC */
+bool
+lqr_reader_scan_by_row(LqrReader *rd)
+{
+    return rd->o->transposed ? false : true;
+}
+
+/* see lqr_carver_get_pixel */
+/* LQR_PUBLIC */
+bool
+lqr_reader_get_pixel(LqrReader *rd, int x, int y, void **rgb)
+{
+    LqrCarver *r = rd->o;
+    int line, u;
+
+    if (!lqr_reader_is_current(rd)) {
+        return false;
+    }
+    if ((x < 0) || (y < 0) || (x >= lqr_reader_get_width(rd)) || (y >= lqr_reader_get_height(rd))) {
+        return false;
+    }
+
+    lqr_cursor_vis_update(rd->c);
+    line = r->transposed ? x : y;
+    u = lqr_cursor_vis_select(rd->c, line, r->transposed ? y : x);
+    (*rgb) = (char *) r->rgb + ((size_t) line * r->w0 + u) * PXL_SIZE(r->col_depth) * r->channels;
+    return true;
+}
+
+/* see lqr_carver_export */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_reader_export(LqrReader *rd, void *dest, size_t row_stride, LqrColDepth col_depth, const int *channel_order)
+{
+    return lqr_reader_export_region(rd, 0, 0, lqr_reader_get_width(rd), lqr_reader_get_height(rd), dest, row_stride,
+                                    col_depth, channel_order);
+}
+
+/* see lqr_carver_export_region */
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_reader_export_region(LqrReader *rd, int x, int y, int width, int height, void *dest, size_t row_stride,
+                         LqrColDepth col_depth, const int *channel_order)
+{
+    LQR_CATCH_F(lqr_reader_is_current(rd));
+    LQR_CATCH_F((x >= 0) && (y >= 0) && (width > 0) && (height > 0));
+    LQR_CATCH_F((x + width <= lqr_reader_get_width(rd)) && (y + height <= lqr_reader_get_height(rd)));
+
+    return lqr_carver_export_cursor(rd->o, rd->c, x, y, width, height, dest, row_stride, col_depth, channel_order);
+}
+
+/**** END OF LQR_READER CLASS FUNCTIONS ****/
@@ -0,0 +1,57 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_READER_PRIV_H__
+#define __LQR_READER_PRIV_H__
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_reader_priv.h"
+#endif /* __LQR_BASE_H__ */
+
+#ifndef __LQR_CURSOR_PUB_H__
+#error "lqr_cursor_pub.h must be included prior to lqr_reader_priv.h"
+#endif /* __LQR_CURSOR_PUB_H__ */
+
+/**** LQR_READER CLASS DEFINITION ****/
+/* The lqr_readers read a carver at a size of their own, which
+ * can be any of those the carver can reach without computing new
+ * maps, each through its own cursor and readout buffer; since they
+ * do not modify the carver, several readers can be used at the
+ * same time from different threads, as long as the carver is not
+ * resized or otherwise modified meanwhile; after it is, their size
+ * must be set again */
+struct _LqrReader {
+    LqrCarver *o;                       /* pointer to the carver read */
+    LqrCursor *c;                       /* cursor, pinned to the reader's level */
+    void *rgb_ro_buffer;                /* readout buffer */
+
+    int w0;                             /* size, orientation and visibility */
+    int h0;                             /* map serial of the carver when */
+    int transposed;                     /* the size was set */
+    unsigned int serial;
+};
+
+/* LQR_READER CLASS PRIVATE FUNCTIONS */
+
+bool lqr_reader_is_current(LqrReader *rd);
+
+#endif /* __LQR_READER_PRIV_H__ */
@@ -0,0 +1,58 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_READER_PUB_H__
+#define __LQR_READER_PUB_H__
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_reader_pub.h"
+#endif /* __LQR_BASE_H__ */
+
+/*** LQR_READER CLASS DECLARATION ***/
+
+struct _LqrReader;
+
+typedef struct _LqrReader LqrReader;
+
+/* LQR_READER PUBLIC FUNCTIONS */
+
+/* constructor & destructor */
+LQR_PUBLIC LqrReader *lqr_reader_new(LqrCarver *r);
+LQR_PUBLIC void lqr_reader_destroy(LqrReader *rd);
+
+/* size */
+LQR_PUBLIC LqrRetVal lqr_reader_set_size(LqrReader *rd, int width, int height);
+LQR_PUBLIC int lqr_reader_get_width(LqrReader *rd);
+LQR_PUBLIC int lqr_reader_get_height(LqrReader *rd);
+
+/* readout */
+LQR_PUBLIC void lqr_reader_scan_reset(LqrReader *rd);
+LQR_PUBLIC bool lqr_reader_scan_ext(LqrReader *rd, int *x, int *y, void **rgb);
+LQR_PUBLIC bool lqr_reader_scan_line_ext(LqrReader *rd, int *n, void **rgb);
+LQR_PUBLIC bool lqr_reader_scan_by_row(LqrReader *rd);
+LQR_PUBLIC bool lqr_reader_get_pixel(LqrReader *rd, int x, int y, void **rgb);
+LQR_PUBLIC LqrRetVal lqr_reader_export(LqrReader *rd, void *dest, size_t row_stride, LqrColDepth col_depth,
+                                       const int *channel_order);
+LQR_PUBLIC LqrRetVal lqr_reader_export_region(LqrReader *rd, int x, int y, int width, int height, void *dest,
+                                              size_t row_stride, LqrColDepth col_depth, const int *channel_order);
+
+#endif /* __LQR_READER_PUB_H__ */
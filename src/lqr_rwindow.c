@@ -125,7 +125,8 @@ lqr_rwindow_fill_custom(LqrReadingWindow *rwindow, LqrCarver *r, int x, int y)
 LqrRetVal
 lqr_rwindow_fill(LqrReadingWindow *rwindow, LqrCarver *r, int x, int y)
 {
-    LQR_CATCH_CANC(r);
+    /* no CANC check here: this is called for each point,
+     * cancellation is checked once per row by the callers */
 
     rwindow->carver = r;
     rwindow->x = x;
@@ -0,0 +1,117 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <time.h>
+
+#include "lqr_all.h"
+
+/**** LQR_STATS FUNCTIONS ****/
+
+uint64_t
+lqr_stats_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+lqr_stats_add_phase(LqrStats *stats, LqrStatsPhase phase, uint64_t t0)
+{
+    atomic_fetch_add_explicit(&stats->ns[phase], lqr_stats_now() - t0, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->calls[phase], 1, memory_order_relaxed);
+}
+
+void
+lqr_stats_read(LqrStats *stats, LqrCarverStats *out)
+{
+    int i;
+
+    for (i = 0; i < LQR_STATS_N_PHASES; i++) {
+        out->ns[i] = atomic_load_explicit(&stats->ns[i], memory_order_relaxed);
+        out->calls[i] = atomic_load_explicit(&stats->calls[i], memory_order_relaxed);
+    }
+    out->energy_evals = atomic_load_explicit(&stats->energy_evals, memory_order_relaxed);
+    out->mmap_cells = atomic_load_explicit(&stats->mmap_cells, memory_order_relaxed);
+    out->bytes_allocated = atomic_load_explicit(&stats->bytes_allocated, memory_order_relaxed);
+}
+
+void
+lqr_stats_reset(LqrStats *stats)
+{
+    int i;
+
+    for (i = 0; i < LQR_STATS_N_PHASES; i++) {
+        atomic_store_explicit(&stats->ns[i], 0, memory_order_relaxed);
+        atomic_store_explicit(&stats->calls[i], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&stats->energy_evals, 0, memory_order_relaxed);
+    atomic_store_explicit(&stats->mmap_cells, 0, memory_order_relaxed);
+    atomic_store_explicit(&stats->bytes_allocated, 0, memory_order_relaxed);
+}
+
+void
+lqr_stats_merge(LqrStats *dest, LqrStats *src)
+{
+    LqrCarverStats s;
+    int i;
+
+    lqr_stats_read(src, &s);
+    for (i = 0; i < LQR_STATS_N_PHASES; i++) {
+        atomic_fetch_add_explicit(&dest->ns[i], s.ns[i], memory_order_relaxed);
+        atomic_fetch_add_explicit(&dest->calls[i], s.calls[i], memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&dest->energy_evals, s.energy_evals, memory_order_relaxed);
+    atomic_fetch_add_explicit(&dest->mmap_cells, s.mmap_cells, memory_order_relaxed);
+    atomic_fetch_add_explicit(&dest->bytes_allocated, s.bytes_allocated, memory_order_relaxed);
+}
+
+/* LQR_PUBLIC */
+LqrRetVal
+lqr_carver_get_stats(LqrCarver *r, LqrCarverStats *stats)
+{
+    memset(stats, 0, sizeof(LqrCarverStats));
+#ifdef LQR_ENABLE_STATS
+    lqr_stats_read(&r->stats, stats);
+    return LQR_OK;
+#else
+    (void) r;
+    return LQR_ERROR;
+#endif /* LQR_ENABLE_STATS */
+}
+
+/* LQR_PUBLIC */
+void
+lqr_carver_reset_stats(LqrCarver *r)
+{
+#ifdef LQR_ENABLE_STATS
+    lqr_stats_reset(&r->stats);
+#else
+    (void) r;
+#endif /* LQR_ENABLE_STATS */
+}
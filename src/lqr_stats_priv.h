@@ -0,0 +1,91 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_STATS_PRIV_H__
+#define __LQR_STATS_PRIV_H__
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_stats_priv.h"
+#endif /* __LQR_BASE_H__ */
+
+#ifndef __LQR_STATS_PUB_H__
+#error "lqr_stats_pub.h must be included prior to lqr_stats_priv.h"
+#endif /* __LQR_STATS_PUB_H__ */
+
+/* Statistics collection macros: without LQR_ENABLE_STATS
+ * they expand to nothing (and the carver has no stats field) */
+
+#ifdef LQR_ENABLE_STATS
+
+/* start timing a phase (this is a declaration) */
+#define LQR_STATS_TIMER(t0) uint64_t t0 = lqr_stats_now()
+
+/* record a completed call of a phase started at t0 */
+#define LQR_STATS_PHASE(r, phase, t0) lqr_stats_add_phase(&(r)->stats, (phase), (t0))
+
+/* add n to one of the counters */
+#define LQR_STATS_COUNT(r, counter, n) \
+    atomic_fetch_add_explicit(&(r)->stats.counter, (uint64_t) (n), memory_order_relaxed)
+
+/* add the statistics of the helper carver c to those of r */
+#define LQR_STATS_MERGE(r, c) lqr_stats_merge(&(r)->stats, &(c)->stats)
+
+#else
+
+#define LQR_STATS_TIMER(t0)
+#define LQR_STATS_PHASE(r, phase, t0) ((void) 0)
+#define LQR_STATS_COUNT(r, counter, n) ((void) 0)
+#define LQR_STATS_MERGE(r, c) ((void) 0)
+
+#endif /* LQR_ENABLE_STATS */
+
+/**** LQR_STATS CLASS DEFINITION ****/
+
+/* counters are updated with relaxed atomic operations,
+ * since they may be written by the threads of the pool
+ * and read by another thread during a resize */
+struct _LqrStats {
+    atomic_uint_least64_t ns[LQR_STATS_N_PHASES];
+    atomic_uint_least64_t calls[LQR_STATS_N_PHASES];
+    atomic_uint_least64_t energy_evals;
+    atomic_uint_least64_t mmap_cells;
+    atomic_uint_least64_t bytes_allocated;
+};
+
+typedef struct _LqrStats LqrStats;
+
+/* LQR_STATS PRIVATE FUNCTIONS */
+
+/* monotonic time in nanoseconds */
+uint64_t lqr_stats_now(void);
+
+void lqr_stats_add_phase(LqrStats *stats, LqrStatsPhase phase, uint64_t t0);
+void lqr_stats_read(LqrStats *stats, LqrCarverStats *out);
+void lqr_stats_reset(LqrStats *stats);
+
+/* add the statistics of a helper carver to those of the carver using it */
+void lqr_stats_merge(LqrStats *dest, LqrStats *src);
+
+#endif /* __LQR_STATS_PRIV_H__ */
@@ -0,0 +1,68 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_STATS_PUB_H__
+#define __LQR_STATS_PUB_H__
+
+#include <stdint.h>
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_stats_pub.h"
+#endif /* __LQR_BASE_H__ */
+
+/* Phases timed by the carver statistics */
+enum _LqrStatsPhase {
+    LQR_STATS_BUILD_EMAP,               /* full energy map computation */
+    LQR_STATS_UPDATE_EMAP,              /* energy map update after a seam removal */
+    LQR_STATS_BUILD_MMAP,               /* full minpath map computation */
+    LQR_STATS_UPDATE_MMAP,              /* minpath map update after a seam removal */
+    LQR_STATS_BUILD_VPATH,              /* seam search */
+    LQR_STATS_CARVE,                    /* seam removal */
+    LQR_STATS_INFLATE,                  /* seam insertion (enlargement) */
+    LQR_STATS_FLATTEN,                  /* multisize image flattening */
+    LQR_STATS_TRANSPOSE,                /* image transposition */
+    LQR_STATS_READOUT,                  /* output scanning */
+    LQR_STATS_N_PHASES
+};
+
+typedef enum _LqrStatsPhase LqrStatsPhase;
+
+/* Carver statistics (all values are cumulative) */
+struct _LqrCarverStats {
+    uint64_t ns[LQR_STATS_N_PHASES];    /* time spent in each phase, in nanoseconds */
+    uint64_t calls[LQR_STATS_N_PHASES]; /* number of completed calls of each phase */
+    uint64_t energy_evals;              /* energy points computed */
+    uint64_t mmap_cells;                /* minpath map points computed */
+    uint64_t bytes_allocated;           /* size of the maps and buffers allocated */
+};
+
+typedef struct _LqrCarverStats LqrCarverStats;
+
+/* LQR_STATS PUBLIC FUNCTIONS */
+
+/* the statistics are only collected if the library was built
+ * with LQR_ENABLE_STATS defined, otherwise lqr_carver_get_stats
+ * returns LQR_ERROR; they can be read while the carver is busy */
+LQR_PUBLIC LqrRetVal lqr_carver_get_stats(LqrCarver *r, LqrCarverStats *stats);
+LQR_PUBLIC void lqr_carver_reset_stats(LqrCarver *r);
+
+#endif /* __LQR_STATS_PUB_H__ */
@@ -0,0 +1,218 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <pthread.h>
+
+#include "lqr_base.h"
+#include "lqr_mem.h"
+#include "lqr_thread_pool.h"
+
+#ifdef __LQR_DEBUG__
+#include <assert.h>
+#endif /* __LQR_DEBUG__ */
+
+/**** LQR_THREAD_POOL CLASS FUNCTIONS ****/
+
+/* helper threads main loop: wait for a new job,
+ * run it and report back */
+void *
+lqr_thread_pool_worker_main(void *arg)
+{
+    LqrThreadWorker *worker = (LqrThreadWorker *) arg;
+    LqrThreadPool *pool = worker->pool;
+    unsigned long seen = 0;
+    LqrThreadFunc func;
+    void *data;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while ((pool->generation == seen) && !pool->quit) {
+            pthread_cond_wait(&pool->job_cond, &pool->lock);
+        }
+        if (pool->quit) {
+            break;
+        }
+        seen = pool->generation;
+        func = pool->func;
+        data = pool->data;
+        pthread_mutex_unlock(&pool->lock);
+
+        func(data, worker->index, pool->n_threads);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->n_running--;
+        if (pool->n_running == 0) {
+            pthread_cond_signal(&pool->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/*** constructor & destructor ***/
+
+LqrThreadPool *
+lqr_thread_pool_new(int n_threads)
+{
+    LqrThreadPool *pool;
+    int i;
+
+#ifdef __LQR_DEBUG__
+    assert(n_threads >= 1);
+#endif /* __LQR_DEBUG__ */
+
+    LQR_TRY_N_N(pool = LRQ_CALLOC(LqrThreadPool, 1));
+    pool->workers = LRQ_CALLOC(LqrThreadWorker, n_threads);
+    if (pool->workers == NULL) {
+        LRQ_FREE(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->job_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    pthread_cond_init(&pool->barrier_cond, NULL);
+    atomic_init(&pool->barrier_count, 0);
+    atomic_init(&pool->barrier_generation, 0);
+
+    pool->n_threads = 1;
+    pool->func = NULL;
+    pool->data = NULL;
+    pool->generation = 0;
+    pool->n_running = 0;
+    pool->quit = false;
+
+    /* the calling thread counts as thread 0 */
+    for (i = 1; i < n_threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        if (pthread_create(&pool->workers[i].thread, NULL, lqr_thread_pool_worker_main, &pool->workers[i]) != 0) {
+            break;
+        }
+        pool->n_threads++;
+    }
+
+    return pool;
+}
+
+void
+lqr_thread_pool_destroy(LqrThreadPool *pool)
+{
+    int i;
+
+    if (pool == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->job_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 1; i < pool->n_threads; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&pool->barrier_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->job_cond);
+    pthread_mutex_destroy(&pool->lock);
+
+    LRQ_FREE(pool->workers);
+    LRQ_FREE(pool);
+}
+
+/*** job control ***/
+
+/* run func on every thread of the pool (the calling
+ * thread included) and return when all are done */
+void
+lqr_thread_pool_run(LqrThreadPool *pool, LqrThreadFunc func, void *data)
+{
+    if (pool->n_threads == 1) {
+        func(data, 0, 1);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->func = func;
+    pool->data = data;
+    pool->n_running = pool->n_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->job_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    func(data, 0, pool->n_threads);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->n_running > 0) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* block until all the threads running the current job
+ * have called this function: waiting threads spin for a
+ * while before going to sleep, since barriers are meant
+ * to separate short chunks of work */
+void
+lqr_thread_pool_barrier(LqrThreadPool *pool)
+{
+    unsigned int generation;
+    int spin;
+
+    if (pool->n_threads == 1) {
+        return;
+    }
+
+    /* the generation must be read before announcing the arrival */
+    generation = atomic_load(&pool->barrier_generation);
+
+    if (atomic_fetch_add(&pool->barrier_count, 1) == pool->n_threads - 1) {
+        /* last one in: release the others */
+        atomic_store(&pool->barrier_count, 0);
+        pthread_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->barrier_generation, 1);
+        pthread_cond_broadcast(&pool->barrier_cond);
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+
+    for (spin = 0; spin < LQR_THREAD_POOL_SPIN; spin++) {
+        if (atomic_load(&pool->barrier_generation) != generation) {
+            return;
+        }
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    while (atomic_load(&pool->barrier_generation) == generation) {
+        pthread_cond_wait(&pool->barrier_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**** END OF LQR_THREAD_POOL CLASS FUNCTIONS ****/
@@ -0,0 +1,89 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef __LQR_THREAD_POOL_PRIV_H__
+#define __LQR_THREAD_POOL_PRIV_H__
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#ifndef __LQR_BASE_H__
+#error "lqr_base.h must be included prior to lqr_thread_pool_priv.h"
+#endif /* __LQR_BASE_H__ */
+
+#ifndef __LQR_THREAD_POOL_PUB_H__
+#error "lqr_thread_pool_pub.h must be included prior to lqr_thread_pool_priv.h"
+#endif /* __LQR_THREAD_POOL_PUB_H__ */
+
+/* number of polls before a thread waiting at a barrier goes to sleep */
+#define LQR_THREAD_POOL_SPIN (4096)
+
+/* job function: called once per thread, with the thread index
+ * (0 is always the calling thread) and the total number of threads */
+typedef void (*LqrThreadFunc) (void *data, int thread_index, int n_threads);
+
+/**** LQR_THREAD_POOL CLASS DEFINITION ****/
+
+struct _LqrThreadWorker {
+    LqrThreadPool *pool;               /* pointer to owner pool */
+    int index;                         /* thread index (starting from 1) */
+    pthread_t thread;                  /* the thread itself */
+};
+
+typedef struct _LqrThreadWorker LqrThreadWorker;
+
+struct _LqrThreadPool {
+    int n_threads;                     /* number of threads, including the caller */
+    LqrThreadWorker *workers;          /* the n_threads - 1 helper threads */
+
+    pthread_mutex_t lock;              /* protects the fields below */
+    pthread_cond_t job_cond;           /* signalled when a new job is posted */
+    pthread_cond_t done_cond;          /* signalled when the last helper is done */
+
+    LqrThreadFunc func;                /* current job function */
+    void *data;                        /* current job data */
+    unsigned long generation;          /* incremented at each new job */
+    int n_running;                     /* helpers still running the current job */
+    bool quit;                         /* set on destruction */
+
+    pthread_cond_t barrier_cond;       /* signalled when a barrier is passed */
+    atomic_int barrier_count;          /* threads arrived at the current barrier */
+    atomic_uint barrier_generation;    /* incremented each time a barrier is passed */
+};
+
+/* LQR_THREAD_POOL CLASS PRIVATE FUNCTIONS */
+
+/* constructor & destructor */
+LqrThreadPool *lqr_thread_pool_new(int n_threads);
+void lqr_thread_pool_destroy(LqrThreadPool *pool);
+
+/* run func on all threads and wait for completion */
+void lqr_thread_pool_run(LqrThreadPool *pool, LqrThreadFunc func, void *data);
+
+/* wait for all threads to reach this point (only valid within a job) */
+void lqr_thread_pool_barrier(LqrThreadPool *pool);
+
+/* helper threads main loop */
+void *lqr_thread_pool_worker_main(void *arg);
+
+#endif /* __LQR_THREAD_POOL_PRIV_H__ */
@@ -51,7 +51,7 @@ lqr_vmap_new(int *buffer, int width, int height, int depth, int orientation)
 void
 lqr_vmap_destroy(LqrVMap *vmap)
 {
-    LRQ_FREE(vmap->buffer);
+    LQR_USER_FREE(vmap->buffer);
     LRQ_FREE(vmap);
 }
 
@@ -96,7 +96,8 @@ LqrVMap *
 lqr_vmap_dump(LqrCarver *r)
 {
     LqrVMap *vmap;
-    int w, h, w1, x, y, z0, vs;
+    int w, h, w1, x, y, z0, u, vs;
+    const int *row;
     int *buffer;
     int depth;
 
@@ -110,12 +111,17 @@ lqr_vmap_dump(LqrCarver *r)
     h = lqr_carver_get_height(r);
     depth = r->w0 - r->w_start;
 
-    LQR_TRY_N_N(buffer = LRQ_CALLOC(int, w * h));
+    LQR_TRY_N_N(buffer = LQR_USER_CALLOC(int, w * h));
 
-    lqr_cursor_reset(r->c);
+    /* read the map row by row; this level is only visited once, so
+     * the cursor's visibility bitmap would not pay for itself */
     for (y = 0; y < r->h; y++) {
-        for (x = 0; x < r->w; x++) {
-            vs = r->vs[r->c->now];
+        row = r->vs + (size_t) y * r->w0;
+        for (x = 0, u = 0; x < r->w; u++) {
+            vs = row[u];
+            if ((vs != 0) && (vs < r->level)) {
+                continue;
+            }
             if (!r->transposed) {
                 z0 = y * r->w + x;
             } else {
@@ -126,7 +132,7 @@ lqr_vmap_dump(LqrCarver *r)
             } else {
                 buffer[z0] = vs - depth;
             }
-            lqr_cursor_next(r->c);
+            x++;
         }
     }
 
@@ -145,7 +151,8 @@ LqrRetVal
 lqr_vmap_internal_dump(LqrCarver *r)
 {
     LqrVMap *vmap;
-    int w, h, w1, x, y, z0, vs;
+    int w, h, w1, x, y, z0, u, vs;
+    const int *row;
     int *buffer;
     int depth;
 
@@ -161,12 +168,17 @@ lqr_vmap_internal_dump(LqrCarver *r)
     h = lqr_carver_get_height(r);
     depth = r->w0 - r->w_start;
 
-    LQR_CATCH_MEM(buffer = LRQ_CALLOC(int, w * h));
+    LQR_CATCH_MEM(buffer = LQR_USER_CALLOC(int, w * h));
 
-    lqr_cursor_reset(r->c);
+    /* read the map row by row; this level is only visited once, so
+     * the cursor's visibility bitmap would not pay for itself */
     for (y = 0; y < r->h; y++) {
-        for (x = 0; x < r->w; x++) {
-            vs = r->vs[r->c->now];
+        row = r->vs + (size_t) y * r->w0;
+        for (x = 0, u = 0; x < r->w; u++) {
+            vs = row[u];
+            if ((vs != 0) && (vs < r->level)) {
+                continue;
+            }
             if (!r->transposed) {
                 z0 = y * r->w + x;
             } else {
@@ -177,7 +189,7 @@ lqr_vmap_internal_dump(LqrCarver *r)
             } else {
                 buffer[z0] = vs - depth;
             }
-            lqr_cursor_next(r->c);
+            x++;
         }
     }
 
@@ -216,6 +228,7 @@ lqr_vmap_load(LqrCarver *r, LqrVMap *vmap)
     if (vmap->orientation != r->transposed) {
         LQR_CATCH(lqr_carver_transpose(r));
     }
+    LQR_CATCH(lqr_carver_unshare_vsmap(r));
 
     for (y = 0; y < r->h; y++) {
         for (x = 0; x < r->w; x++) {
@@ -229,6 +242,7 @@ lqr_vmap_load(LqrCarver *r, LqrVMap *vmap)
             r->vs[z1] = vmap->buffer[z0];
         }
     }
+    r->vs_serial++;
 
     LQR_CATCH(lqr_carver_inflate(r, vmap->depth));
 
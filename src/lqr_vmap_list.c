@@ -61,6 +61,7 @@ lqr_vmap_list_destroy(LqrVMapList *list)
     if (now != NULL) {
         lqr_vmap_list_destroy(now->next);
         lqr_vmap_destroy(now->current);
+        LRQ_FREE(now);
     }
 }
 
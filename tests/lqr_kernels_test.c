@@ -0,0 +1,165 @@
+/* LiquidRescaling Library
+ * Copyright (C) 2007-2009 Carlo Baldassi (the "Author") <carlobaldassi@gmail.com>.
+ * All Rights Reserved.
+ *
+ * This library implements the algorithm described in the paper
+ * "Seam Carving for Content-Aware Image Resizing"
+ * by Shai Avidan and Ariel Shamir
+ * which can be found at http://www.faculty.idc.ac.il/arik/imret.pdf
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3 dated June, 2007.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+
+/* Checks that the vectorized kernels give exactly the same results
+ * as the scalar ones at every level supported by the cpu: minpath
+ * rows (values and predecessors, without rigidity, with rigidity
+ * and with a rigidity mask, for both tie-breaking rules) and
+ * gradient rows are compared bit for bit.
+ *
+ * usage: lqr-kernels-test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lqr_all.h"
+
+#define TEST_W 1003
+#define TEST_ROWS 64
+
+static const char *level_names[] = { "scalar", "sse4.2", "avx2", "avx512" };
+
+static uint32_t test_seed = 12345;
+
+static uint32_t
+test_rand(void)
+{
+    test_seed ^= test_seed << 13;
+    test_seed ^= test_seed >> 17;
+    test_seed ^= test_seed << 5;
+    return test_seed;
+}
+
+/* random value in [0, scale); with ties, only a few distinct values */
+static float
+test_value(float scale, int ties)
+{
+    if (ties) {
+        return (float) (test_rand() % 4) * scale / 4;
+    }
+    return (float) (test_rand() % 1000000) * scale / 1000000;
+}
+
+/* returns the number of points which differ from the scalar kernel */
+static int
+test_minpath(LqrMinpathRowFunc kernel, int rigidity, int leftright)
+{
+    float m_down[TEST_W], en[TEST_W], mask[TEST_W];
+    float m0[TEST_W], m1[TEST_W];
+    int8_t least0[TEST_W], least1[TEST_W];
+    int raw[TEST_W];
+    float rig[3];
+    LqrMinpathRow row;
+    int y, x, bad = 0;
+
+    row.w = TEST_W;
+    row.delta_x = 1;
+    row.leftright = leftright;
+    row.m_down = m_down;
+    row.raw = raw;
+    row.en = en;
+    row.rigidity_map = rigidity ? rig + 1 : NULL;
+    row.rigidity_mask = rigidity == 2 ? mask : NULL;
+
+    for (y = 0; y < TEST_ROWS; y++) {
+        for (x = 0; x < TEST_W; x++) {
+            m_down[x] = test_value(100, y % 2);
+            en[x] = test_value(10, y % 2);
+            mask[x] = test_value(2, 0);
+            raw[x] = (int) (test_rand() % TEST_W);
+        }
+        rig[0] = rig[2] = test_value(1, 0);
+        rig[1] = 0;
+
+        row.m = m0;
+        row.least = least0;
+        lqr_minpath_row_scalar(&row, 0, TEST_W);
+        row.m = m1;
+        row.least = least1;
+        kernel(&row, 0, TEST_W);
+
+        for (x = 0; x < TEST_W; x++) {
+            if ((memcmp(&m0[x], &m1[x], sizeof(float)) != 0) || (least0[x] != least1[x])) {
+                bad++;
+            }
+        }
+    }
+    return bad;
+}
+
+/* returns the number of points which differ from the scalar kernel */
+static int
+test_grad(LqrGradRowFunc kernel, LqrGradFuncType gf_type)
+{
+    double up[TEST_W], now[TEST_W], down[TEST_W];
+    float out0[TEST_W], out1[TEST_W];
+    int y, x, bad = 0;
+
+    for (y = 0; y < TEST_ROWS; y++) {
+        for (x = 0; x < TEST_W; x++) {
+            up[x] = test_value(1, 0);
+            now[x] = test_value(1, 0);
+            down[x] = test_value(1, 0);
+        }
+        lqr_grad_row_scalar(gf_type, up, now, down, 0.5, out0, 1, TEST_W - 1);
+        kernel(gf_type, up, now, down, 0.5, out1, 1, TEST_W - 1);
+
+        for (x = 1; x < TEST_W - 1; x++) {
+            if (memcmp(&out0[x], &out1[x], sizeof(float)) != 0) {
+                bad++;
+            }
+        }
+    }
+    return bad;
+}
+
+int
+main(void)
+{
+    static const LqrGradFuncType gf_types[] = { LQR_GF_NORM, LQR_GF_SUMABS, LQR_GF_XABS };
+    LqrCpuLevel level, max_level = lqr_cpu_detect();
+    LqrKernels kernels;
+    int rigidity, leftright, i;
+    int bad, failed = 0;
+
+    for (level = LQR_CPU_LEVEL_SCALAR; level <= max_level; level++) {
+        lqr_kernels_select(&kernels, level);
+        for (rigidity = 0; rigidity <= 2; rigidity++) {
+            for (leftright = 0; leftright <= 1; leftright++) {
+                bad = test_minpath(kernels.minpath_row_dx1, rigidity, leftright);
+                printf("%s minpath rigidity=%d leftright=%d: %d/%d differ\n", level_names[level], rigidity,
+                       leftright, bad, TEST_W * TEST_ROWS);
+                failed |= bad != 0;
+            }
+        }
+        for (i = 0; i < 3; i++) {
+            bad = test_grad(kernels.grad_row, gf_types[i]);
+            printf("%s gradient type=%d: %d/%d differ\n", level_names[level], gf_types[i], bad,
+                   (TEST_W - 2) * TEST_ROWS);
+            failed |= bad != 0;
+        }
+    }
+
+    return failed;
+}